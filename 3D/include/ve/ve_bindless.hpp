@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ve_descriptors.hpp"
+#include "ve_device.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+
+namespace ve {
+
+	// Hands out slots in a bindless descriptor array. Released slots are only reused once every frame
+	// that could still index them has finished, so nextFrame() must be called once per frame.
+	class VeBindlessHandleAllocator {
+	public:
+		explicit VeBindlessHandleAllocator(uint32_t capacity) : capacity{ capacity } {}
+
+		uint32_t allocate();
+		void release(uint32_t handle);
+		void nextFrame();
+
+		uint32_t getCapacity() const { return capacity; }
+		uint32_t getAllocatedCount() const { return nextHandle - static_cast<uint32_t>(freeHandles.size() + retiredHandles.size()); }
+
+	private:
+		struct RetiredHandle {
+			uint32_t handle;
+			uint64_t releaseFrame;
+		};
+
+		uint32_t capacity;
+		uint32_t nextHandle = 0;
+		uint64_t frameCounter = 0;
+		std::vector<uint32_t> freeHandles;
+		std::deque<RetiredHandle> retiredHandles;
+	};
+
+	// Single descriptor set holding large, partially bound arrays of storage buffers, sampled images and
+	// samplers. Resources are registered once and referenced from shaders by the returned index, so any
+	// draw can use any resource without rebinding descriptor sets. Shaders declare the arrays unsized and
+	// index them with nonuniformEXT (GL_EXT_nonuniform_qualifier).
+	class VeBindlessDescriptors {
+	public:
+		static constexpr uint32_t STORAGE_BUFFER_BINDING = 0;
+		static constexpr uint32_t SAMPLED_IMAGE_BINDING = 1;
+		static constexpr uint32_t SAMPLER_BINDING = 2;
+
+		// requested counts are clamped to the device's update-after-bind limits, per array and in total
+		VeBindlessDescriptors(
+			VeDevice& device,
+			uint32_t maxStorageBuffers = 65536,
+			uint32_t maxSampledImages = 65536,
+			uint32_t maxSamplers = 256);
+
+		VeBindlessDescriptors(const VeBindlessDescriptors&) = delete;
+		VeBindlessDescriptors& operator=(const VeBindlessDescriptors&) = delete;
+
+		uint32_t addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo);
+		uint32_t addSampledImage(VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uint32_t addSampler(VkSampler sampler);
+
+		void updateStorageBuffer(uint32_t handle, const VkDescriptorBufferInfo& bufferInfo);
+		void updateSampledImage(uint32_t handle, VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		void removeStorageBuffer(uint32_t handle) { storageBufferHandles.release(handle); }
+		void removeSampledImage(uint32_t handle) { sampledImageHandles.release(handle); }
+		void removeSampler(uint32_t handle) { samplerHandles.release(handle); }
+
+		// call once per frame, after the frame's fence has been waited on
+		void nextFrame();
+
+		void bind(
+			VkCommandBuffer commandBuffer,
+			VkPipelineLayout pipelineLayout,
+			uint32_t set,
+			VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+		VeDescriptorSetLayout& getSetLayout() const { return *setLayout; }
+		VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+	private:
+		void write(uint32_t binding, uint32_t handle, VkDescriptorType type, const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo);
+
+		VeDevice& veDevice;
+		std::unique_ptr<VeDescriptorSetLayout> setLayout;
+		std::unique_ptr<VeDescriptorPool> pool;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+		VeBindlessHandleAllocator storageBufferHandles;
+		VeBindlessHandleAllocator sampledImageHandles;
+		VeBindlessHandleAllocator samplerHandles;
+	};
+} // namespace ve
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ve_buffer.hpp"
+#include "ve_camera.hpp"
+#include "ve_descriptors.hpp"
+#include "ve_device.hpp"
+#include "ve_light_buffer.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace ve {
+
+	// std430 layout shared with shaders/clustered_lighting.glsl
+	struct ClusterGridHeader {
+		glm::uvec4 gridSize{};		// tiles x, tiles y, depth slices, light count
+		glm::vec4 screenParams{};	// viewport width, height, slice scale, slice bias
+	};
+
+	// Forward+ light culling on a froxel grid: the view frustum is split into screen tiles and exponential
+	// depth slices, each light is binned into every cluster its bounding sphere touches, and the fragment
+	// shader only loops over the light list of its own cluster. Binning runs on the CPU each frame.
+	class VeClusteredLighting {
+	public:
+		static constexpr uint32_t LIGHTS_BINDING = 0;
+		static constexpr uint32_t CLUSTER_GRID_BINDING = 1;
+		static constexpr uint32_t LIGHT_INDICES_BINDING = 2;
+
+		struct Config {
+			uint32_t tilesX = 16;
+			uint32_t tilesY = 9;
+			uint32_t depthSlices = 24;
+			uint32_t maxLightIndices = 16 * 9 * 24 * 64;
+		};
+
+		// lights are read from lightBuffer, which is bound as LIGHTS_BINDING
+		VeClusteredLighting(VeDevice& device, VeLightBuffer& lightBuffer, const Config& config);
+		VeClusteredLighting(VeDevice& device, VeLightBuffer& lightBuffer)
+			: VeClusteredLighting(device, lightBuffer, Config{}) {}
+
+		VeClusteredLighting(const VeClusteredLighting&) = delete;
+		VeClusteredLighting& operator=(const VeClusteredLighting&) = delete;
+
+		// flushes the light buffer, then bins its lights against camera's perspective projection and writes
+		// the frame's cluster buffers; extent is the viewport the grid's tiles are laid over
+		void update(int frameIndex, const VeCamera& camera, VkExtent2D extent);
+
+		void bind(
+			VkCommandBuffer commandBuffer,
+			int frameIndex,
+			VkPipelineLayout pipelineLayout,
+			uint32_t set,
+			VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+		VeDescriptorSetLayout& getSetLayout() const { return *setLayout; }
+		VkDescriptorSet getDescriptorSet(int frameIndex) const { return frames[frameIndex].descriptorSet; }
+
+		uint32_t getClusterCount() const { return config.tilesX * config.tilesY * config.depthSlices; }
+
+		// light references dropped last update because the index list was full
+		uint32_t getDroppedLightIndices() const { return droppedLightIndices; }
+
+	private:
+		struct FrameResources {
+			VkBuffer boundLightBuffer = VK_NULL_HANDLE;
+			std::unique_ptr<VeBuffer> clusterGridBuffer;
+			std::unique_ptr<VeBuffer> lightIndexBuffer;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		};
+
+		struct ClusterBounds {
+			glm::uvec3 min;
+			glm::uvec3 max;
+		};
+
+		bool computeClusterBounds(
+			const glm::vec3& viewPosition,
+			float range,
+			const glm::mat4& projection,
+			float sliceScale,
+			float sliceBias,
+			ClusterBounds& bounds) const;
+
+		std::unique_ptr<VeBuffer> createMappedStorageBuffer(VkDeviceSize instanceSize, uint32_t instanceCount);
+
+		VeDevice& veDevice;
+		VeLightBuffer& lightBuffer;
+		Config config;
+
+		std::unique_ptr<VeDescriptorSetLayout> setLayout;
+		std::unique_ptr<VeDescriptorPool> descriptorPool;
+		std::vector<FrameResources> frames;
+
+		// reused between updates to avoid per frame allocations
+		std::vector<ClusterBounds> boundsScratch;
+		std::vector<uint32_t> clusterCounts;
+		std::vector<glm::uvec2> clusterRanges;
+
+		uint32_t droppedLightIndices = 0;
+	};
+} // namespace ve
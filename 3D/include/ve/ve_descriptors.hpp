@@ -4,11 +4,14 @@
 
 // std
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 namespace ve {
 
+    class VeDescriptorSetLayoutCache;
+
     class VeDescriptorSetLayout {
     public:
         class Builder {
@@ -19,15 +22,26 @@ namespace ve {
                 uint32_t binding,
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
-                uint32_t count = 1);
+                uint32_t count = 1,
+                VkDescriptorBindingFlags bindingFlags = 0);
+            Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<VeDescriptorSetLayout> build() const;
 
+            // returns the cache's layout for an identical binding list instead of creating a new one
+            VeDescriptorSetLayout& build(VeDescriptorSetLayoutCache& cache) const;
+
         private:
             VeDevice& veDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
         };
 
-        VeDescriptorSetLayout(VeDevice& veDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+        VeDescriptorSetLayout(
+            VeDevice& veDevice,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {});
         ~VeDescriptorSetLayout();
         VeDescriptorSetLayout(const VeDescriptorSetLayout&) = delete;
         VeDescriptorSetLayout& operator=(const VeDescriptorSetLayout&) = delete;
@@ -82,19 +96,205 @@ namespace ve {
         friend class VeDescriptorWriter;
     };
 
+    // Hands out descriptor sets from a growing list of VeDescriptorPools, creating a new pool whenever
+    // the current one is exhausted. Sets can't be freed individually; resetPools() recycles every pool
+    // at once, so keep one manager per frame in flight for transient sets and reset it when the frame
+    // slot comes around again.
+    class VeDescriptorPoolManager {
+    public:
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        struct PoolUsage {
+            uint32_t allocatedSets;
+            uint32_t maxSets;
+        };
+
+        class Builder {
+        public:
+            Builder(VeDevice& veDevice) : veDevice{ veDevice } {}
+
+            // count is per set, each pool reserves count * maxSets descriptors of the type
+            Builder& addPoolRatio(VkDescriptorType descriptorType, float count);
+            Builder& setPoolFlags(VkDescriptorPoolCreateFlags flags);
+            Builder& setInitialSetsPerPool(uint32_t count);
+            std::unique_ptr<VeDescriptorPoolManager> build() const;
+
+        private:
+            VeDevice& veDevice;
+            std::vector<std::pair<VkDescriptorType, float>> poolRatios{};
+            uint32_t initialSetsPerPool = 256;
+            VkDescriptorPoolCreateFlags poolFlags = 0;
+        };
+
+        VeDescriptorPoolManager(
+            VeDevice& veDevice,
+            uint32_t initialSetsPerPool,
+            VkDescriptorPoolCreateFlags poolFlags,
+            const std::vector<std::pair<VkDescriptorType, float>>& poolRatios);
+        VeDescriptorPoolManager(const VeDescriptorPoolManager&) = delete;
+        VeDescriptorPoolManager& operator=(const VeDescriptorPoolManager&) = delete;
+
+        // only fails if the layout doesn't fit into an empty pool
+        bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor);
+
+        void resetPools();
+
+        std::vector<PoolUsage> getPoolUsage() const;
+        uint32_t getAllocatedSetCount() const;
+
+    private:
+        struct Pool {
+            std::unique_ptr<VeDescriptorPool> pool;
+            PoolUsage usage;
+        };
+
+        Pool acquirePool();
+
+        VeDevice& veDevice;
+        std::vector<std::pair<VkDescriptorType, float>> poolRatios;
+        VkDescriptorPoolCreateFlags poolFlags;
+        uint32_t nextSetsPerPool;
+
+        // the last entry of usedPools is the one currently allocated from
+        std::vector<Pool> usedPools;
+        std::vector<Pool> freePools;
+    };
+
+    // Owns one VeDescriptorSetLayout per distinct binding list, bindings are compared in binding order.
+    class VeDescriptorSetLayoutCache {
+    public:
+        VeDescriptorSetLayoutCache(VeDevice& veDevice) : veDevice{ veDevice } {}
+        VeDescriptorSetLayoutCache(const VeDescriptorSetLayoutCache&) = delete;
+        VeDescriptorSetLayoutCache& operator=(const VeDescriptorSetLayoutCache&) = delete;
+
+        VeDescriptorSetLayout& getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+        size_t size();
+
+    private:
+        struct LayoutKey {
+            std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+            bool operator==(const LayoutKey& other) const;
+        };
+
+        struct LayoutKeyHash {
+            size_t operator()(const LayoutKey& key) const;
+        };
+
+        VeDevice& veDevice;
+
+        std::mutex cacheMutex;
+        std::unordered_map<LayoutKey, std::unique_ptr<VeDescriptorSetLayout>, LayoutKeyHash> layouts;
+    };
+
+    // Reuses descriptor sets written with identical resources. Sets are allocated from the cache's own
+    // pools and live until clear(), which must be called before any resource referenced by a cached set
+    // is destroyed, otherwise a recycled handle could match a stale set.
+    class VeDescriptorSetCache {
+    public:
+        VeDescriptorSetCache(
+            VeDevice& veDevice,
+            const std::vector<std::pair<VkDescriptorType, float>>& poolRatios);
+        VeDescriptorSetCache(const VeDescriptorSetCache&) = delete;
+        VeDescriptorSetCache& operator=(const VeDescriptorSetCache&) = delete;
+
+        // writes' dstSet is filled in, they are only applied when a new set is allocated
+        bool getDescriptorSet(
+            VkDescriptorSetLayout setLayout,
+            std::vector<VkWriteDescriptorSet>& writes,
+            VkDescriptorSet& set);
+
+        void clear();
+        size_t size();
+
+    private:
+        using SetKey = std::vector<uint64_t>;
+
+        struct SetKeyHash {
+            size_t operator()(const SetKey& key) const;
+        };
+
+        VeDevice& veDevice;
+        VeDescriptorPoolManager poolManager;
+
+        std::mutex cacheMutex;
+        std::unordered_map<SetKey, VkDescriptorSet, SetKeyHash> sets;
+    };
+
+    // Precompiled description of a write list. update() reads every descriptor from a packed struct, one
+    // VkDescriptorBufferInfo, VkDescriptorImageInfo or VkBufferView per descriptor in the order the writes
+    // were added.
+    // Without Vulkan 1.1 the same data is applied through vkUpdateDescriptorSets.
+    class VeDescriptorUpdateTemplate {
+    public:
+        VeDescriptorUpdateTemplate(
+            VeDevice& veDevice,
+            VkDescriptorSetLayout setLayout,
+            const std::vector<VkDescriptorUpdateTemplateEntry>& entries,
+            size_t dataSize);
+        ~VeDescriptorUpdateTemplate();
+        VeDescriptorUpdateTemplate(const VeDescriptorUpdateTemplate&) = delete;
+        VeDescriptorUpdateTemplate& operator=(const VeDescriptorUpdateTemplate&) = delete;
+
+        void update(VkDescriptorSet set, const void* data) const;
+
+        size_t getDataSize() const { return dataSize; }
+
+    private:
+        VeDevice& veDevice;
+        VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+        std::vector<VkDescriptorUpdateTemplateEntry> entries;
+        size_t dataSize;
+    };
+
     class VeDescriptorWriter {
     public:
         VeDescriptorWriter(VeDescriptorSetLayout& setLayout, VeDescriptorPool& pool);
+        VeDescriptorWriter(VeDescriptorSetLayout& setLayout, VeDescriptorPoolManager& poolManager);
+        VeDescriptorWriter(VeDescriptorSetLayout& setLayout, VeDescriptorSetCache& setCache);
 
         VeDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
         VeDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
 
+        // writes count consecutive array elements starting at firstArrayElement; infos must stay alive
+        // until build/overwrite. Elements left unwritten by build() are undefined, so only leave gaps
+        // shaders never read or the binding is PARTIALLY_BOUND
+        VeDescriptorWriter& writeBuffers(
+            uint32_t binding,
+            const VkDescriptorBufferInfo* bufferInfos,
+            uint32_t count,
+            uint32_t firstArrayElement = 0);
+        VeDescriptorWriter& writeImages(
+            uint32_t binding,
+            const VkDescriptorImageInfo* imageInfos,
+            uint32_t count,
+            uint32_t firstArrayElement = 0);
+        VeDescriptorWriter& writeBuffers(
+            uint32_t binding,
+            const std::vector<VkDescriptorBufferInfo>& bufferInfos,
+            uint32_t firstArrayElement = 0) {
+            return writeBuffers(binding, bufferInfos.data(), static_cast<uint32_t>(bufferInfos.size()), firstArrayElement);
+        }
+        VeDescriptorWriter& writeImages(
+            uint32_t binding,
+            const std::vector<VkDescriptorImageInfo>& imageInfos,
+            uint32_t firstArrayElement = 0) {
+            return writeImages(binding, imageInfos.data(), static_cast<uint32_t>(imageInfos.size()), firstArrayElement);
+        }
+
         bool build(VkDescriptorSet& set);
         void overwrite(VkDescriptorSet& set);
 
+        // compiles the writes added so far; their info pointers are only used for the data layout
+        std::unique_ptr<VeDescriptorUpdateTemplate> buildUpdateTemplate() const;
+
     private:
+        VkWriteDescriptorSet& addWrite(uint32_t binding, uint32_t count, uint32_t firstArrayElement);
+
         VeDescriptorSetLayout& setLayout;
-        VeDescriptorPool& pool;
+        VeDescriptorPool* pool = nullptr;
+        VeDescriptorPoolManager* poolManager = nullptr;
+        VeDescriptorSetCache* setCache = nullptr;
         std::vector<VkWriteDescriptorSet> writes;
     };
 
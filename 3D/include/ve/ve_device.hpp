@@ -3,11 +3,14 @@
 #include "ve_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace ve {
 
+    class VeShaderCache;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
@@ -44,10 +47,29 @@ namespace ve {
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        VkPipelineCache pipelineCache() { return pipelineCache_; }
+        uint32_t apiVersion() const { return apiVersion_; }
+        bool isExtensionEnabled(const char* extensionName) const;
+
+        // descriptor indexing with partially bound, update-after-bind arrays, see VeBindlessDescriptors
+        bool supportsBindless() const { return bindlessSupported_; }
+        // multiDrawIndirect together with drawIndirectFirstInstance
+        bool supportsMultiDrawIndirect() const { return multiDrawIndirectSupported_; }
+        // VK_KHR_dynamic_rendering, recorded through cmdBeginRendering/cmdEndRendering
+        bool supportsDynamicRendering() const { return dynamicRenderingSupported_; }
+        void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo* renderingInfo) {
+            cmdBeginRendering_(commandBuffer, renderingInfo);
+        }
+        void cmdEndRendering(VkCommandBuffer commandBuffer) { cmdEndRendering_(commandBuffer); }
+        // highest sample count usable by both color and depth framebuffer attachments
+        VkSampleCountFlagBits getMaxUsableSampleCount() const;
+        VeShaderCache& shaderCache() { return *shaderCache_; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
         QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
+        // meaningful bits of timestamps written on the graphics queue, 0 when it can't write any
+        uint32_t getTimestampValidBits();
         VkFormat findSupportedFormat(
             const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -69,16 +91,28 @@ namespace ve {
             VkMemoryPropertyFlags properties,
             VkImage& image,
             VkDeviceMemory& imageMemory);
+        // for attachments with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT: backed by lazily allocated memory
+        // where the device has it (tile memory on tilers), device local memory otherwise
+        void createTransientAttachment(const VkImageCreateInfo& imageInfo, VkImage& image, VkDeviceMemory& imageMemory);
 
         VkPhysicalDeviceProperties properties;
+        VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+
+        static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+        // highest version requested, apiVersion() is lower when the loader or device can't provide it
+        static constexpr uint32_t TARGET_API_VERSION = VK_API_VERSION_1_2;
 
     private:
         void createInstance();
         void setupDebugMessenger();
         void createSurface();
         void pickPhysicalDevice();
+        void queryOptionalFeatures();
         void createLogicalDevice();
         void createCommandPool();
+        void createPipelineCache();
+        void savePipelineCache();
 
         // helper functions
         bool isDeviceSuitable(VkPhysicalDevice device);
@@ -89,12 +123,23 @@ namespace ve {
         void hasGflwRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+        bool isPipelineCacheCompatible(const std::vector<char>& cacheData);
 
         VkInstance instance;
         VkDebugUtilsMessengerEXT debugMessenger;
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
         VeWindow& window;
         VkCommandPool commandPool;
+        VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+        uint32_t apiVersion_ = VK_API_VERSION_1_0;
+        std::vector<const char*> enabledDeviceExtensions_;
+        VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures_{};
+        bool bindlessSupported_ = false;
+        bool multiDrawIndirectSupported_ = false;
+        bool dynamicRenderingSupported_ = false;
+        PFN_vkCmdBeginRenderingKHR cmdBeginRendering_ = nullptr;
+        PFN_vkCmdEndRenderingKHR cmdEndRendering_ = nullptr;
+        std::unique_ptr<VeShaderCache> shaderCache_;
 
         VkDevice device_;
         VkSurfaceKHR surface_;
@@ -103,6 +148,11 @@ namespace ve {
 
         const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
         const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
+        // enabled when the device offers them, features depending on them check isExtensionEnabled
+        const std::vector<const char*> optionalDeviceExtensions = {
+            VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+            VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME };
     };
 
 }  // namespace lve
\ No newline at end of file
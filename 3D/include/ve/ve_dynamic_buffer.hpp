@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ve_buffer.hpp"
+#include "ve_device.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+
+
+namespace ve {
+
+	// Per-frame ring of per-object data bound through a UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC
+	// descriptor. Each frame in flight owns a region of maxObjectsPerFrame slots spaced by the device's
+	// offset alignment; a draw selects its object with the offset from getDynamicOffset(), so one
+	// descriptor set serves every object and the data is not limited by the push constant size.
+	class VeDynamicBuffer {
+	public:
+		VeDynamicBuffer(
+			VeDevice& device,
+			VkDeviceSize objectSize,
+			uint32_t maxObjectsPerFrame,
+			VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+
+		VeDynamicBuffer(const VeDynamicBuffer&) = delete;
+		VeDynamicBuffer& operator=(const VeDynamicBuffer&) = delete;
+
+		// selects the frame's region and rewinds push()
+		void beginFrame(int frameIndex);
+
+		// appends one object to the current frame and returns its index
+		uint32_t push(const void* data);
+
+		// copies count objects laid out with getAlignmentSize() stride in a single memcpy
+		void writeObjects(const void* data, uint32_t count, uint32_t firstObject = 0);
+
+		// for writing objects in place, stride is getAlignmentSize()
+		void* getObjectMemory(uint32_t objectIndex) const;
+
+		uint32_t getDynamicOffset(uint32_t objectIndex) const;
+
+		// descriptor range covers one object, the dynamic offset picks which
+		VkDescriptorBufferInfo descriptorInfo() const;
+
+		VkDescriptorType getDescriptorType() const { return descriptorType; }
+		VkDeviceSize getAlignmentSize() const { return buffer->getAlignmentSize(); }
+		uint32_t getMaxObjectsPerFrame() const { return maxObjectsPerFrame; }
+		uint32_t getObjectCount() const { return objectCount; }
+
+	private:
+		static VkDeviceSize minOffsetAlignment(VeDevice& device, VkDescriptorType descriptorType);
+
+		VkDescriptorType descriptorType;
+		uint32_t maxObjectsPerFrame;
+		std::unique_ptr<VeBuffer> buffer;
+
+		uint32_t frameBase = 0;
+		uint32_t objectCount = 0;
+	};
+} // namespace ve
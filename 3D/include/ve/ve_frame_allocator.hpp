@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ve_buffer.hpp"
+#include "ve_device.hpp"
+
+// std
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+
+namespace ve {
+
+	// Linear allocator for data that only lives for one frame (uniforms, instance data, dynamic vertices).
+	// One persistently mapped, host coherent buffer is split into a region per frame in flight; allocations
+	// bump through the current region and beginFrame() rewinds it once that frame's fence has signalled,
+	// so nothing is created, mapped or flushed per frame.
+	class VeFrameAllocator {
+	public:
+		static constexpr VkBufferUsageFlags DEFAULT_USAGE =
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+		struct Allocation {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;
+
+			VkDescriptorBufferInfo descriptorInfo() const { return { buffer, offset, size }; }
+		};
+
+		VeFrameAllocator(VeDevice& device, VkDeviceSize bytesPerFrame, VkBufferUsageFlags usageFlags = DEFAULT_USAGE);
+
+		VeFrameAllocator(const VeFrameAllocator&) = delete;
+		VeFrameAllocator& operator=(const VeFrameAllocator&) = delete;
+
+		// only call once the GPU has finished the previous use of frameIndex
+		void beginFrame(int frameIndex);
+
+		// alignment of 0 uses the strictest of the device's uniform and storage buffer offset alignments
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+		template<typename T>
+		Allocation push(const T& data, VkDeviceSize alignment = 0) {
+			Allocation allocation = allocate(sizeof(T), alignment);
+			memcpy(allocation.mapped, &data, sizeof(T));
+			return allocation;
+		}
+
+		VkBuffer getBuffer() const { return buffer->getBuffer(); }
+		VkDeviceSize getBytesPerFrame() const { return bytesPerFrame; }
+		VkDeviceSize getBytesUsed() const { return head - frameBase; }
+
+	private:
+		std::unique_ptr<VeBuffer> buffer;
+		VkDeviceSize bytesPerFrame;
+		VkDeviceSize defaultAlignment;
+
+		VkDeviceSize frameBase = 0;
+		VkDeviceSize head = 0;
+	};
+} // namespace ve
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ve_device.hpp"
+
+// std
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace ve {
+
+	// GPU time of named, possibly nested scopes, measured with timestamp queries. Every frame in flight has
+	// its own query pool, which is read back once that frame's fence has signalled, MAX_FRAMES_IN_FLIGHT
+	// frames after recording, so results never stall the CPU. Each scope keeps a rolling average over the
+	// last averageWindow frames it ran in.
+	//
+	//   profiler.beginFrame(commandBuffer, frameIndex);	// after the fence wait and vkBeginCommandBuffer
+	//   profiler.beginScope(commandBuffer, "shadows");
+	//   ...
+	//   profiler.endScope(commandBuffer);
+	class VeGpuProfiler {
+	public:
+		static constexpr uint32_t DEFAULT_MAX_SCOPES = 64;
+		static constexpr uint32_t DEFAULT_AVERAGE_WINDOW = 120;
+
+		struct ScopeStats {
+			std::string name;
+			uint32_t depth = 0;		// nesting level when first recorded
+			float lastMs = 0.f;		// summed over all uses in the last frame it ran in
+			float averageMs = 0.f;
+			float minMs = 0.f;
+			float maxMs = 0.f;
+		};
+
+		VeGpuProfiler(
+			VeDevice& device,
+			uint32_t maxScopesPerFrame = DEFAULT_MAX_SCOPES,
+			uint32_t averageWindow = DEFAULT_AVERAGE_WINDOW);
+		~VeGpuProfiler();
+
+		VeGpuProfiler(const VeGpuProfiler&) = delete;
+		VeGpuProfiler& operator=(const VeGpuProfiler&) = delete;
+
+		// false when the graphics queue can't write timestamps, every call is then a no-op
+		bool isSupported() const { return supported; }
+
+		// collects frameIndex's previous results and resets its queries, outside a render pass
+		void beginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+
+		// scopes must be closed in the command buffer they were opened in; stage is where the timestamp is
+		// written, the defaults cover all work recorded between the two calls
+		void beginScope(
+			VkCommandBuffer commandBuffer,
+			const std::string& name,
+			VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		void endScope(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+		// in order of first appearance
+		const std::vector<ScopeStats>& getScopeStats() const { return stats; }
+		// nullptr for scopes that never completed a frame
+		const ScopeStats* findScope(const std::string& name) const;
+		float getLastMs(const std::string& name) const;
+		float getAverageMs(const std::string& name) const;
+
+		// indented table of all scopes
+		void printStats(std::ostream& out) const;
+		// one row per scope: name, depth, last, average, min and max in milliseconds
+		void writeCsv(const std::string& filepath) const;
+
+	private:
+		struct RecordedScope {
+			uint32_t statsIndex;
+			bool ended = false;
+		};
+
+		struct FrameQueries {
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			std::vector<RecordedScope> scopes;
+		};
+
+		// samples of the last averageWindow frames a scope ran in
+		struct History {
+			std::vector<float> samples;
+			uint32_t next = 0;
+			float sum = 0.f;
+		};
+
+		void collectResults(FrameQueries& frame);
+		void addSample(uint32_t statsIndex, float ms);
+
+		VeDevice& veDevice;
+		uint32_t maxScopesPerFrame;
+		uint32_t averageWindow;
+		bool supported = false;
+		uint64_t timestampMask = ~0ull;
+		float timestampPeriod = 1.f;
+
+		std::vector<FrameQueries> frames;
+		int currentFrameIndex = -1;
+		std::vector<uint32_t> openScopes;
+
+		std::vector<ScopeStats> stats;
+		std::vector<History> histories;
+		std::unordered_map<std::string, uint32_t> statsIndices;
+	};
+} // namespace ve
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "ve_buffer.hpp"
+#include "ve_camera.hpp"
+#include "ve_descriptors.hpp"
+#include "ve_device.hpp"
+#include "ve_shader_cache.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace ve {
+
+	// std430 layout shared with shaders/hiz_cull.comp
+	struct HiZCullObject {
+		glm::vec4 boundingSphere{};	// world space center, radius in w
+		uint32_t indexCount = 0;
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t firstInstance = 0;	// passed through to the draw, e.g. an index into per object data
+	};
+
+	// std140 layout shared with shaders/hiz_cull.comp
+	struct HiZCullData {
+		glm::mat4 view{ 1.f };
+		glm::vec4 projection{};		// P00, P11, P22, P32 of the perspective projection
+		glm::vec4 frustum{};		// side planes of the symmetric frustum, see VeHiZCulling::cullFirstPhase
+		glm::vec4 depthRange{};		// near, far
+		glm::uvec4 objectCount{};
+	};
+
+	// GPU occlusion culling against a hierarchical depth (Hi-Z) pyramid, max reduced from the swap chain's
+	// depth buffer by compute. Objects are bounding spheres that each become one indexed indirect draw.
+	//
+	// Culling runs in two phases so objects never pop in a frame late: phase one draws the objects that
+	// were visible last frame, the pyramid is built from that depth, and phase two tests every object
+	// against it, draws the ones phase one missed and records visibility for the next frame. Object i must
+	// refer to the same object every frame. The renderer must be created with VeSwapChain::Config::sampledDepth.
+	// Usage per frame, with all draws using the same index and vertex buffers:
+	//
+	//   hiZCulling.setObjects(frameIndex, objects);
+	//   hiZCulling.cullFirstPhase(commandBuffer, frameIndex, camera, renderer.getSwapChainExtent());
+	//   renderer.beginSwapChainRenderPass(commandBuffer, true);
+	//   hiZCulling.drawFirstPhase(commandBuffer, frameIndex);
+	//   renderer.suspendSwapChainRenderPass(commandBuffer);
+	//   hiZCulling.buildPyramid(commandBuffer, frameIndex, renderer.getCurrentDepthImageView());
+	//   hiZCulling.cullSecondPhase(commandBuffer, frameIndex);
+	//   renderer.resumeSwapChainRenderPass(commandBuffer);
+	//   hiZCulling.drawSecondPhase(commandBuffer, frameIndex);
+	//   renderer.endSwapChainRenderPass(commandBuffer);
+	class VeHiZCulling {
+	public:
+		static constexpr uint32_t CULL_DATA_BINDING = 0;
+		static constexpr uint32_t OBJECTS_BINDING = 1;
+		static constexpr uint32_t VISIBILITY_BINDING = 2;
+		static constexpr uint32_t DRAW_COMMANDS_BINDING = 3;
+		static constexpr uint32_t DEPTH_PYRAMID_BINDING = 4;
+
+		VeHiZCulling(
+			VeDevice& device,
+			uint32_t maxObjects,
+			const std::string& downsampleShaderFilepath = "shaders/hiz_downsample.comp.spv",
+			const std::string& cullShaderFilepath = "shaders/hiz_cull.comp.spv");
+		~VeHiZCulling();
+
+		VeHiZCulling(const VeHiZCulling&) = delete;
+		VeHiZCulling& operator=(const VeHiZCulling&) = delete;
+
+		// call once the frame's fence has signalled
+		void setObjects(int frameIndex, const std::vector<HiZCullObject>& objects);
+
+		// forget last frame's visibility from the next cullFirstPhase() on, e.g. after a camera cut; everything
+		// is then drawn in phase two
+		void resetVisibility() { visibilityResetPending = true; }
+
+		// matches the pyramid to the depth buffer's extent, recreating it after a device wait when that
+		// changed. Must not be called while recorded work still uses the pyramid, cullFirstPhase() calls it
+		// before recording any
+		void resize(VkExtent2D extent);
+
+		// outside a render pass, before the frame's first draws; extent is the depth buffer's
+		void cullFirstPhase(VkCommandBuffer commandBuffer, int frameIndex, const VeCamera& camera, VkExtent2D extent);
+		// depthView must be in SHADER_READ_ONLY_OPTIMAL and have the extent given to cullFirstPhase()
+		void buildPyramid(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView);
+		void cullSecondPhase(VkCommandBuffer commandBuffer, int frameIndex);
+
+		void drawFirstPhase(VkCommandBuffer commandBuffer, int frameIndex) const { draw(commandBuffer, frameIndex, 0); }
+		void drawSecondPhase(VkCommandBuffer commandBuffer, int frameIndex) const { draw(commandBuffer, frameIndex, 1); }
+
+		uint32_t getMaxObjects() const { return maxObjects; }
+		VkExtent2D getPyramidExtent() const { return pyramidExtent; }
+		uint32_t getPyramidMipCount() const { return pyramidMipCount; }
+		VkDescriptorImageInfo pyramidDescriptorInfo() const {
+			return VkDescriptorImageInfo{ sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL };
+		}
+
+	private:
+		struct FrameResources {
+			std::unique_ptr<VeBuffer> cullDataBuffer;
+			std::unique_ptr<VeBuffer> objectBuffer;
+			uint32_t objectCount = 0;
+			VkDescriptorSet cullSet = VK_NULL_HANDLE;
+			VkDescriptorSet depthDownsampleSet = VK_NULL_HANDLE;
+		};
+
+		void createSampler();
+		void createDescriptorLayouts();
+		void createPipelines(const std::string& downsampleShaderFilepath, const std::string& cullShaderFilepath);
+		void createBuffers();
+		void createPyramid(VkExtent2D extent);
+		void destroyPyramid();
+		void dispatchCull(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase);
+		void draw(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase) const;
+
+		VeDevice& veDevice;
+		uint32_t maxObjects;
+
+		VkSampler sampler = VK_NULL_HANDLE;
+
+		std::unique_ptr<VeDescriptorSetLayout> downsampleSetLayout;
+		std::unique_ptr<VeDescriptorSetLayout> cullSetLayout;
+		std::unique_ptr<VeDescriptorPool> cullDescriptorPool;
+		std::unique_ptr<VeDescriptorPool> pyramidDescriptorPool;
+
+		std::shared_ptr<VeShaderModule> downsampleShader;
+		std::shared_ptr<VeShaderModule> cullShader;
+		VkPipelineLayout downsamplePipelineLayout = VK_NULL_HANDLE;
+		VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline downsamplePipeline = VK_NULL_HANDLE;
+		VkPipeline cullPipeline = VK_NULL_HANDLE;
+
+		// visibility persists across frames, draw commands hold both phases back to back
+		std::unique_ptr<VeBuffer> visibilityBuffer;
+		std::unique_ptr<VeBuffer> drawCommandBuffer;
+		std::vector<FrameResources> frames;
+		bool visibilityResetPending = true;
+
+		VkExtent2D pyramidExtent{ 0, 0 };
+		uint32_t pyramidMipCount = 0;
+		VkImage pyramidImage = VK_NULL_HANDLE;
+		VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+		VkImageView pyramidView = VK_NULL_HANDLE;
+		std::vector<VkImageView> pyramidMipViews;
+		// reduces mip i - 1 into mip i, entry 0 is unused as mip 0 reads the frame's depth set
+		std::vector<VkDescriptorSet> pyramidMipSets;
+	};
+} // namespace ve
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ve_buffer.hpp"
+#include "ve_device.hpp"
+#include "ve_game_object.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace ve {
+
+	// std430 layout shared with shaders/clustered_lighting.glsl
+	struct PointLightData {
+		glm::vec4 position{};	// w is the range the light is clipped to
+		glm::vec4 color{};		// w is intensity
+
+		bool operator==(const PointLightData& other) const {
+			return position == other.position && color == other.color;
+		}
+		bool operator!=(const PointLightData& other) const { return !(*this == other); }
+	};
+
+	// Point lights in a storage buffer laid out as a uvec4 count followed by the light array. Each frame in
+	// flight has its own host visible copy, and only lights that changed since that copy was last written
+	// are uploaded, so static lights cost nothing per frame. Buffers grow on demand; getBuffer() then
+	// returns a new handle and descriptors referencing the old one must be rewritten.
+	class VeLightBuffer {
+	public:
+		VeLightBuffer(VeDevice& device, uint32_t initialCapacity = 256, float attenuationCutoff = 0.01f);
+
+		VeLightBuffer(const VeLightBuffer&) = delete;
+		VeLightBuffer& operator=(const VeLightBuffer&) = delete;
+
+		// adds, updates or removes lights so the buffer matches the point lights of gameObjects
+		void sync(VeGameObject::Map& gameObjects);
+
+		void setLight(VeGameObject::id_t id, const PointLightData& light);
+		void removeLight(VeGameObject::id_t id);
+
+		// uploads the changes frameIndex's copy hasn't seen yet, call once its fence has signalled
+		void flush(int frameIndex);
+
+		// a light's range ends where intensity / distance^2 drops below the attenuation cutoff
+		float lightRange(float intensity, const glm::vec3& color) const;
+
+		const std::vector<PointLightData>& getLights() const { return lights; }
+		uint32_t getLightCount() const { return static_cast<uint32_t>(lights.size()); }
+
+		VkBuffer getBuffer(int frameIndex) const { return frames[frameIndex].buffer->getBuffer(); }
+		VkDescriptorBufferInfo descriptorInfo(int frameIndex) const {
+			return VkDescriptorBufferInfo{ getBuffer(frameIndex), 0, VK_WHOLE_SIZE };
+		}
+
+	private:
+		struct FrameBuffer {
+			std::unique_ptr<VeBuffer> buffer;
+			uint32_t capacity = 0;
+			std::vector<uint32_t> dirtySlots;
+			std::vector<bool> isDirty;
+		};
+
+		void createFrameBuffer(FrameBuffer& frame, uint32_t capacity);
+		void markDirty(uint32_t slot);
+
+		VeDevice& veDevice;
+		float attenuationCutoff;
+
+		std::vector<PointLightData> lights;
+		std::vector<VeGameObject::id_t> slotOwners;
+		std::unordered_map<VeGameObject::id_t, uint32_t> slots;
+		std::vector<FrameBuffer> frames;
+
+		// reused by sync() to find lights whose game object is gone
+		std::vector<VeGameObject::id_t> removedScratch;
+	};
+} // namespace ve
@@ -27,6 +27,10 @@ namespace ve {
 			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 
+			// tightly packed positions only, for bindPositions()
+			static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions();
+
 			bool operator==(const Vertex& other) const {
 				return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
 			}
@@ -48,6 +52,8 @@ namespace ve {
 		static std::unique_ptr<VeModel> createModelFromFile(VeDevice& device, const std::string& filePath);
 
 		void bind(VkCommandBuffer commandBuffer);
+		// binds a separate position-only stream, depth-only passes fetch 12 bytes per vertex instead of 44
+		void bindPositions(VkCommandBuffer commandBuffer);
 		void draw(VkCommandBuffer commandBuffer);
 
 	private:
@@ -57,6 +63,7 @@ namespace ve {
 		VeDevice& veDevice;
 
 		std::unique_ptr<VeBuffer> vertexBuffer;
+		std::unique_ptr<VeBuffer> positionBuffer;
 		uint32_t vertexCount;
 
 		bool hasIndexBuffer{ false };
@@ -1,18 +1,58 @@
 #pragma once
 
 #include "ve_device.hpp"
+#include "ve_shader_cache.hpp"
 
 // std
+#include <cassert>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 
 namespace ve {
 
+	// Specialization constant values for one shader stage, matched to
+	// layout(constant_id = N) declarations in the shader
+	struct ShaderSpecialization {
+		template<typename T>
+		ShaderSpecialization& setConstant(uint32_t constantID, const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>, "Specialization constants must be trivially copyable");
+			static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Specialization constants must be 32 or 64 bit scalars (use VkBool32 for bools)");
+
+			for (auto& entry : mapEntries) {
+				if (entry.constantID == constantID) {
+					assert(entry.size == sizeof(T) && "Specialization constant redefined with a different size");
+					memcpy(data.data() + entry.offset, &value, sizeof(T));
+					return *this;
+				}
+			}
+
+			mapEntries.push_back({ constantID, static_cast<uint32_t>(data.size()), sizeof(T) });
+			data.resize(data.size() + sizeof(T));
+			memcpy(data.data() + mapEntries.back().offset, &value, sizeof(T));
+			return *this;
+		}
+
+		bool empty() const { return mapEntries.empty(); }
+
+		// points into this struct, so it must outlive the returned info
+		VkSpecializationInfo getSpecializationInfo() const;
+		size_t hash() const;
+
+		bool operator==(const ShaderSpecialization& other) const;
+
+		std::vector<VkSpecializationMapEntry> mapEntries{};
+		std::vector<uint8_t> data{};
+	};
+
+	// Copyable description of a graphics pipeline. The pAttachments and pDynamicStates pointers are
+	// re-targeted at colorBlendAttachment and dynamicStateEnables when the pipeline is created, so copies
+	// never alias the state of the config they were copied from.
 	struct PipelineConfigInfo {
 		PipelineConfigInfo() = default;
-		PipelineConfigInfo(const PipelineConfigInfo&) = delete;
-		PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
@@ -28,6 +68,15 @@ namespace ve {
 		VkPipelineLayout pipelineLayout = nullptr;
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		// attachment formats of dynamic rendering, used instead of renderPass when that is null
+		std::vector<VkFormat> colorAttachmentFormats{};
+		VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+		ShaderSpecialization vertSpecialization{};
+		ShaderSpecialization fragSpecialization{};
+
+		// covers all state baked into the pipeline, pointers and sType/pNext are ignored
+		size_t hash() const;
+		bool operator==(const PipelineConfigInfo& other) const;
 	};
 
 
@@ -48,20 +97,30 @@ namespace ve {
 		void bind(VkCommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 
-	private:
-		static std::vector<char> readFile(const std::string& filepath);
+		// depth-only state for a pre-pass subpass: position-only vertex stream, no color attachments
+		static void depthPrePassPipelineConfigInfo(PipelineConfigInfo& configInfo);
+		// turns a config into one that shades only the surfaces the pre-pass left visible; both vertex
+		// shaders must declare gl_Position invariant so the depths match exactly
+		static void enableDepthEqualTest(PipelineConfigInfo& configInfo);
+		// rasterizes with the sample count of a multisampled render pass, e.g. VeRenderer::getMsaaSamples()
+		static void enableMultisampling(PipelineConfigInfo& configInfo, VkSampleCountFlagBits samples);
+		// builds the pipeline for VK_KHR_dynamic_rendering into attachments of these formats instead of a
+		// render pass, so it survives anything that recreates render passes; pass no color formats for
+		// depth-only pipelines
+		static void enableDynamicRendering(
+			PipelineConfigInfo& configInfo,
+			const std::vector<VkFormat>& colorFormats,
+			VkFormat depthFormat);
 
+	private:
 		void createGraphicsPipeline(
 			const std::string& vertFilepath,
 			const std::string& fragFilepath,
 			const PipelineConfigInfo& configInfo);
 
-		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
-
-
 		VeDevice& veDevice;
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
+		std::shared_ptr<VeShaderModule> vertShaderModule;
+		std::shared_ptr<VeShaderModule> fragShaderModule;
 	};
 } // namespace ve
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ve_device.hpp"
+#include "ve_pipeline.hpp"
+
+// std
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace ve {
+
+	// Central registry of graphics pipelines. Requesting a pipeline with the same shaders and an equal
+	// PipelineConfigInfo returns the existing VkPipeline instead of compiling a duplicate.
+	// Configs are keyed on their layout and render pass handles, so call clear() whenever those are
+	// destroyed (e.g. when the swap chain is recreated) to avoid matching against recycled handles.
+	class VePipelineCache {
+	public:
+		VePipelineCache(VeDevice& device) : veDevice{ device } {}
+
+		VePipelineCache(const VePipelineCache&) = delete;
+		VePipelineCache& operator=(const VePipelineCache&) = delete;
+
+		std::shared_ptr<VePipeline> getPipeline(
+			const std::string& vertFilepath,
+			const std::string& fragFilepath,
+			const PipelineConfigInfo& configInfo);
+
+		// drops every pipeline built from the given .spv file, e.g. after it was recompiled
+		void invalidate(const std::string& shaderFilepath);
+		void clear();
+		size_t size();
+
+	private:
+		struct Key {
+			std::string vertFilepath;
+			std::string fragFilepath;
+			PipelineConfigInfo configInfo;
+
+			bool operator==(const Key& other) const {
+				return vertFilepath == other.vertFilepath && fragFilepath == other.fragFilepath &&
+					configInfo == other.configInfo;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		VeDevice& veDevice;
+
+		std::mutex cacheMutex;
+		// pipelines still compiling on another thread are already in here, their future not yet ready
+		std::unordered_map<Key, std::shared_future<std::shared_ptr<VePipeline>>, KeyHash> pipelines;
+	};
+} // namespace ve
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ve_device.hpp"
+#include "ve_pipeline.hpp"
+
+// std
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace ve {
+
+	// Pipeline that may still be compiling on a VePipelineCompiler worker thread.
+	// Poll it from the render loop; it never blocks unless wait() is called.
+	class VeAsyncPipeline {
+	public:
+		VeAsyncPipeline(std::future<std::unique_ptr<VePipeline>> pending, VePipeline* fallback);
+
+		VeAsyncPipeline(const VeAsyncPipeline&) = delete;
+		VeAsyncPipeline& operator=(const VeAsyncPipeline&) = delete;
+
+		bool isReady();
+		void wait();
+
+		// nullptr until compilation finishes, rethrows if compilation failed
+		VePipeline* get();
+
+		// binds the compiled pipeline, or the fallback while it is still compiling.
+		// returns false when neither is available and the caller should skip its draws
+		bool bind(VkCommandBuffer commandBuffer);
+
+		void setFallback(VePipeline* pipeline) { fallback = pipeline; }
+
+	private:
+		std::future<std::unique_ptr<VePipeline>> pending;
+		std::unique_ptr<VePipeline> pipeline;
+		VePipeline* fallback;
+	};
+
+	class VePipelineCompiler {
+	public:
+		VePipelineCompiler(VeDevice& device, uint32_t workerCount = 0);
+		~VePipelineCompiler();
+
+		VePipelineCompiler(const VePipelineCompiler&) = delete;
+		VePipelineCompiler& operator=(const VePipelineCompiler&) = delete;
+
+		// configInfo is copied, the caller's config may go out of scope once this returns
+		std::shared_ptr<VeAsyncPipeline> compile(
+			const std::string& vertFilepath,
+			const std::string& fragFilepath,
+			const PipelineConfigInfo& configInfo,
+			VePipeline* fallback = nullptr);
+
+	private:
+		void workerLoop();
+
+		VeDevice& veDevice;
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex queueMutex;
+		std::condition_variable queueCondition;
+		bool stopping{ false };
+	};
+} // namespace ve
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ve_descriptors.hpp"
+#include "ve_device.hpp"
+#include "ve_pipeline.hpp"
+#include "ve_shader_reflection.hpp"
+
+// std
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace ve {
+
+	struct ReflectedPipelineLayout {
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+
+		// indexed by set number, sets a shader skips get an empty layout
+		std::vector<VeDescriptorSetLayout*> setLayouts;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+	};
+
+	// Builds pipeline layouts from shader reflection instead of by hand. Set layouts come from the shared
+	// VeDescriptorSetLayoutCache and identical pipeline layouts are created once.
+	class VePipelineLayoutCache {
+	public:
+		VePipelineLayoutCache(VeDevice& device, VeDescriptorSetLayoutCache& setLayoutCache)
+			: veDevice{ device }, setLayoutCache{ setLayoutCache } {}
+		~VePipelineLayoutCache();
+
+		VePipelineLayoutCache(const VePipelineLayoutCache&) = delete;
+		VePipelineLayoutCache& operator=(const VePipelineLayoutCache&) = delete;
+
+		// use setLayout for the given set number instead of reflecting it, e.g. the bindless set whose
+		// runtime sized arrays have no count in SPIR-V. Must be called before any layout is requested
+		void setExternalSetLayout(uint32_t set, VeDescriptorSetLayout* setLayout);
+
+		// merges the interface of all stages; bindings declared by several stages must agree on type and count
+		const ReflectedPipelineLayout& getPipelineLayout(const std::vector<const ShaderReflection*>& stages);
+
+		// sets configInfo.pipelineLayout and the vertex input state from the shaders' reflection.
+		// Existing attributeDescriptions are checked against the vertex shader inputs and trimmed to the
+		// locations it reads; without any, a tightly packed single binding layout is derived
+		const ReflectedPipelineLayout& configure(
+			PipelineConfigInfo& configInfo,
+			const std::string& vertFilepath,
+			const std::string& fragFilepath);
+
+	private:
+		using LayoutKey = std::vector<uint64_t>;
+
+		struct LayoutKeyHash {
+			size_t operator()(const LayoutKey& key) const;
+		};
+
+		void configureVertexInput(PipelineConfigInfo& configInfo, const ShaderReflection& vertReflection) const;
+
+		VeDevice& veDevice;
+		VeDescriptorSetLayoutCache& setLayoutCache;
+		std::unordered_map<uint32_t, VeDescriptorSetLayout*> externalSetLayouts;
+
+		std::mutex cacheMutex;
+		std::unordered_map<LayoutKey, ReflectedPipelineLayout, LayoutKeyHash> pipelineLayouts;
+	};
+} // namespace ve
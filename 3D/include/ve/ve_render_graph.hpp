@@ -0,0 +1,265 @@
+#pragma once
+
+#include "ve_device.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace ve {
+
+	// how a pass touches a resource, each maps to pipeline stages, access flags and an image layout
+	enum class VeRenderGraphAccess {
+		ColorAttachment,
+		DepthAttachment,
+		DepthReadOnly,
+		SampledFragment,
+		SampledCompute,
+		StorageReadCompute,
+		StorageWriteCompute,
+		IndirectRead,
+		VertexInputRead,
+		TransferRead,
+		TransferWrite,
+	};
+
+	// Frame graph: passes declare which images and buffers they read and write, and compile() works out
+	// everything that was written by hand around the swap chain render pass so far:
+	//  - passes that contribute nothing to an imported resource (or a side effect) are culled
+	//  - one pipeline barrier per pass with the minimal stages, accesses and layout transitions
+	//  - a VkRenderPass and framebuffers per graphics pass, with load/store ops derived from whether the
+	//    previous and next users of an attachment need its contents
+	//  - transient images whose lifetimes don't overlap share memory
+	//
+	// Passes run in declaration order on the graphics queue. Scheduling compute or transfer passes onto
+	// other queues is not done yet: it needs per-queue command buffers, queue family ownership transfers
+	// and semaphores between the submits, none of which the renderer's single submit provides.
+	//
+	// The graph is declared once, compiled for an extent (again whenever
+	// VeRenderer::getSwapChainGeneration() changes) and executed every frame:
+	//
+	//   auto backbuffer = graph.importSwapChainImage("backbuffer", renderer.getSwapChainImageFormat());
+	//   auto depth = graph.createImage("depth", { depthFormat });
+	//   auto main = graph.addGraphicsPass("main", [&](VkCommandBuffer commandBuffer) { ... });
+	//   main.writeColor(backbuffer, clearColor);
+	//   main.writeDepth(depth, clearDepth);
+	//   graph.compile(renderer.getSwapChainExtent());
+	//   ...
+	//   graph.setImportedImage(backbuffer, renderer.getCurrentSwapChainImage(), renderer.getCurrentSwapChainImageView());
+	//   graph.execute(commandBuffer);
+	class VeRenderGraph {
+	public:
+		using ResourceHandle = uint32_t;
+		using PassHandle = uint32_t;
+		using ExecuteFunction = std::function<void(VkCommandBuffer)>;
+
+		struct ImageDesc {
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			// 0 follows the extent passed to compile()
+			VkExtent2D extent{ 0, 0 };
+			VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+		};
+
+		class PassBuilder {
+		public:
+			PassBuilder& writeColor(ResourceHandle image);
+			PassBuilder& writeColor(ResourceHandle image, const VkClearColorValue& clearValue);
+			PassBuilder& writeDepth(ResourceHandle image);
+			PassBuilder& writeDepth(ResourceHandle image, const VkClearDepthStencilValue& clearValue);
+			PassBuilder& readDepth(ResourceHandle image);
+			PassBuilder& read(ResourceHandle resource, VeRenderGraphAccess access);
+			PassBuilder& write(ResourceHandle resource, VeRenderGraphAccess access);
+
+			// keep the pass even if nothing reads what it writes, e.g. buffers read back next frame
+			PassBuilder& setSideEffect();
+
+		private:
+			PassBuilder(VeRenderGraph& graph, PassHandle pass) : graph{ graph }, pass{ pass } {}
+
+			VeRenderGraph& graph;
+			PassHandle pass;
+
+			friend class VeRenderGraph;
+		};
+
+		VeRenderGraph(VeDevice& device) : veDevice{ device } {}
+		~VeRenderGraph();
+
+		VeRenderGraph(const VeRenderGraph&) = delete;
+		VeRenderGraph& operator=(const VeRenderGraph&) = delete;
+
+		// owned by the graph, valid from compile() on
+		ResourceHandle createImage(const std::string& name, const ImageDesc& desc);
+
+		// owned elsewhere and bound every frame with setImportedImage/setImportedBuffer. initialStage is the
+		// stage a semaphore wait or earlier submission makes the image available in
+		ResourceHandle importImage(
+			const std::string& name,
+			VkFormat format,
+			VkImageLayout initialLayout,
+			VkImageLayout finalLayout,
+			VkPipelineStageFlags initialStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		// acquired image, contents discarded, presented at the end of the frame
+		ResourceHandle importSwapChainImage(const std::string& name, VkFormat format) {
+			return importImage(
+				name,
+				format,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		}
+		ResourceHandle importBuffer(const std::string& name);
+
+		void setImportedImage(ResourceHandle image, VkImage vkImage, VkImageView view);
+		void setImportedBuffer(ResourceHandle buffer, VkBuffer vkBuffer);
+
+		// graphics passes run inside their own render pass with a full viewport and scissor set
+		PassBuilder addGraphicsPass(const std::string& name, ExecuteFunction execute);
+		PassBuilder addComputePass(const std::string& name, ExecuteFunction execute);
+
+		// (re)creates transient images, render passes and framebuffers; waits for the device when replacing
+		// objects that may be in use. Render passes are reused while their attachments don't change, so
+		// pipelines built against getRenderPass() stay valid across resizes
+		void compile(VkExtent2D extent);
+		void execute(VkCommandBuffer commandBuffer);
+
+		VkRenderPass getRenderPass(PassHandle pass) const { return passes[pass].renderPass; }
+		PassHandle getPass(const PassBuilder& builder) const { return builder.pass; }
+		bool isPassCulled(PassHandle pass) const { return passes[pass].culled; }
+
+		VkImage getImage(ResourceHandle image) const { return resources[image].image; }
+		VkImageView getImageView(ResourceHandle image) const { return resources[image].view; }
+		VkExtent2D getImageExtent(ResourceHandle image) const;
+
+		// memory actually allocated for transient images, after aliasing
+		VkDeviceSize getTransientMemorySize() const;
+
+	private:
+		enum class ResourceType { Image, Buffer };
+
+		struct Resource {
+			std::string name;
+			ResourceType type = ResourceType::Image;
+			bool imported = false;
+			ImageDesc desc{};
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags initialStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+
+			// filled in by compile()
+			VkImageUsageFlags usage = 0;
+			int firstPass = -1;
+			int lastPass = -1;
+			int memoryBlock = -1;
+			// transient image whose memory this one takes over, or its own last use from the previous frame
+			ResourceHandle previousOccupant = 0;
+		};
+
+		struct Use {
+			ResourceHandle resource;
+			VeRenderGraphAccess access;
+			bool write;
+			bool clear = false;
+			VkClearValue clearValue{};
+
+			// attachments only, filled in by compile()
+			VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		};
+
+		struct Barrier {
+			ResourceHandle resource;
+			VkImageLayout oldLayout;
+			VkImageLayout newLayout;
+			VkPipelineStageFlags srcStage;
+			VkAccessFlags srcAccess;
+			VkPipelineStageFlags dstStage;
+			VkAccessFlags dstAccess;
+		};
+
+		struct Pass {
+			std::string name;
+			bool graphics = true;
+			bool sideEffect = false;
+			ExecuteFunction execute;
+			std::vector<Use> uses;
+
+			// filled in by compile()
+			bool culled = false;
+			std::vector<Barrier> barriers;
+			VkRenderPass renderPass = VK_NULL_HANDLE;
+			std::vector<ResourceHandle> attachments;
+			std::vector<VkClearValue> clearValues;
+			VkExtent2D extent{ 0, 0 };
+		};
+
+		struct MemoryBlock {
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 1;
+			uint32_t memoryTypeBits = ~0u;
+			int freeAfterPass = -1;
+			ResourceHandle lastOccupant = 0;
+			ResourceHandle firstOccupant = 0;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+		};
+
+		// state of a resource between passes while computing barriers
+		struct ResourceState {
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags writeStages = 0;
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStages = 0;
+			// read stages a barrier already made the last write visible to
+			VkPipelineStageFlags syncedReadStages = 0;
+			bool hasContents = false;
+		};
+
+		struct AccessInfo {
+			VkPipelineStageFlags stages;
+			VkAccessFlags access;
+			VkImageLayout layout;
+			VkImageUsageFlags usage;
+		};
+		static AccessInfo getAccessInfo(VeRenderGraphAccess access, bool write);
+		static bool isDepthFormat(VkFormat format);
+		static bool hasStencil(VkFormat format);
+
+		ResourceHandle addResource(Resource resource);
+		void addUse(PassHandle pass, const Use& use);
+
+		void cullPasses();
+		void computeLifetimes();
+		void computeLoadStoreOps();
+		void computeBarriers();
+		void createTransientImages();
+		void destroyTransientImages();
+		void createRenderPasses();
+		VkRenderPass getOrCreateRenderPass(const std::vector<VkAttachmentDescription>& attachments, bool hasDepth);
+		VkFramebuffer getOrCreateFramebuffer(const Pass& pass);
+		void destroyFramebuffers();
+		void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers);
+
+		VeDevice& veDevice;
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+		VkExtent2D compiledExtent{ 0, 0 };
+		bool compiled = false;
+
+		std::vector<MemoryBlock> memoryBlocks;
+		// transitions of imported images into their final layout after the last pass
+		std::vector<Barrier> finalBarriers;
+
+		// keyed by the attachment descriptions, kept for the graph's lifetime so pipelines stay compatible
+		std::map<std::vector<uint32_t>, VkRenderPass> renderPassCache;
+		// keyed by render pass and attachment views, cleared on compile()
+		std::map<std::vector<uint64_t>, VkFramebuffer> framebufferCache;
+	};
+} // namespace ve
@@ -3,6 +3,8 @@
 #include "ve_window.hpp"
 #include "ve_swap_chain.hpp"
 #include "ve_device.hpp"
+#include "ve_frame_allocator.hpp"
+#include "ve_gpu_profiler.hpp"
 
 //std
 #include <memory>
@@ -12,16 +14,64 @@
 namespace ve {
 	class VeRenderer {
 	public:
-		VeRenderer(VeWindow& window, VeDevice& device);
+		static constexpr VkDeviceSize DEFAULT_FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024;
+
+		VeRenderer(
+			VeWindow& window,
+			VeDevice& device,
+			VkDeviceSize frameAllocatorSize = DEFAULT_FRAME_ALLOCATOR_SIZE,
+			const VeSwapChain::Config& swapChainConfig = VeSwapChain::Config{});
 		~VeRenderer();
 
 		VeRenderer(const VeRenderer&) = delete;
 		VeRenderer& operator=(const VeRenderer&) = delete;
 
+		// VK_NULL_HANDLE with VeSwapChain::Config::dynamicRendering, pipelines are then built with
+		// VePipeline::enableDynamicRendering() for getSwapChainImageFormat() and getSwapChainDepthFormat()
 		VkRenderPass getSwapChainRenderPass() const { return veSwapChain->getRenderPass(); }
+		bool usesDynamicRendering() const { return swapChainConfig.dynamicRendering; }
+
+		// render systems opt into the pre-pass by drawing depth-only in DEPTH_PREPASS_SUBPASS before
+		// beginMainSubpass(), everything else targets getMainSubpass()
+		bool hasDepthPrePass() const { return veSwapChain->hasDepthPrePass(); }
+		uint32_t getMainSubpass() const { return veSwapChain->getMainSubpass(); }
+		// pipelines for the swap chain render pass must match it, see VePipeline::enableMultisampling()
+		VkSampleCountFlagBits getMsaaSamples() const { return veSwapChain->getMsaaSamples(); }
+
+		// timed scopes of every frame begun by this renderer; the swap chain render pass is recorded as
+		// DEPTH_PREPASS_SCOPE and MAIN_PASS_SCOPE, other work can add its own between beginFrame/endFrame
+		VeGpuProfiler& getGpuProfiler() const { return *gpuProfiler; }
+		static constexpr const char* DEPTH_PREPASS_SCOPE = "depth pre-pass";
+		static constexpr const char* MAIN_PASS_SCOPE = "main pass";
+
+		// GPU time of the last completed frame's pre-pass and main subpass, 0 when timestamps are unsupported
+		float getDepthPrePassTimeMs() const { return gpuProfiler->getLastMs(DEPTH_PREPASS_SCOPE); }
+		float getMainPassTimeMs() const { return gpuProfiler->getLastMs(MAIN_PASS_SCOPE); }
 
 		bool isFrameInProgress() const { return isFrameStarted; }
 		float getAspectRatio() const { return veSwapChain->extentAspectRatio(); }
+		VkExtent2D getSwapChainExtent() const { return veSwapChain->getSwapChainExtent(); }
+		VkFormat getSwapChainImageFormat() const { return veSwapChain->getSwapChainImageFormat(); }
+		VkFormat getSwapChainDepthFormat() const { return veSwapChain->getSwapChainDepthFormat(); }
+
+		// bumped whenever the swap chain is recreated, e.g. to recompile a VeRenderGraph
+		uint32_t getSwapChainGeneration() const { return swapChainGeneration; }
+
+		// the acquired image, for drawing outside the swap chain render pass
+		VkImage getCurrentSwapChainImage() const {
+			assert(isFrameStarted && "Cannot get swap chain image when frame not in progress.");
+			return veSwapChain->getImage(currentImageIndex);
+		}
+		VkImageView getCurrentSwapChainImageView() const {
+			assert(isFrameStarted && "Cannot get swap chain image view when frame not in progress.");
+			return veSwapChain->getImageView(currentImageIndex);
+		}
+
+		// in SHADER_READ_ONLY_OPTIMAL while a suspendable render pass is suspended
+		VkImageView getCurrentDepthImageView() const {
+			assert(isFrameStarted && "Cannot get depth image view when frame not in progress.");
+			return veSwapChain->getDepthImageView();
+		}
 		VkCommandBuffer getCurrentCommandBuffer() const {
 			assert(isFrameStarted && "Cannot get command buffer when frame not in progress.");
 			return commandBuffers[currentFrameIndex];
@@ -32,23 +82,58 @@ namespace ve {
 			return currentFrameIndex; 
 		}
 
+		// transient per-frame memory, rewound by beginFrame() after the frame's fence wait
+		VeFrameAllocator& getFrameAllocator() const {
+			assert(isFrameStarted && "Cannot get frame allocator when frame not in progress.");
+			return *frameAllocator;
+		}
+
 		VkCommandBuffer beginFrame();
 		void endFrame();
-		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		// a suspendable render pass can be ended in its main subpass with suspendSwapChainRenderPass(), after
+		// which compute work may sample getCurrentDepthImageView() before resumeSwapChainRenderPass()
+		// continues drawing into the same color and depth attachments. Needs VeSwapChain::Config::sampledDepth
+		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, bool suspendable = false);
+		void suspendSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		void resumeSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		void beginMainSubpass(VkCommandBuffer commandBuffer);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
 	private:
 		void createCommandBuffers();
 		void freeCommandBuffers();
 		void recreateSwapChain();
+		void setFullViewport(VkCommandBuffer commandBuffer);
+
+		// dynamic rendering counterparts of the swap chain render pass's attachment ops and subpass
+		// dependencies; the pre-pass is its own depth-only rendering scope
+		void beginDynamicRendering(VkCommandBuffer commandBuffer, bool depthOnly, bool loadColor, bool loadDepth);
+		VkImageAspectFlags getDepthAspectMask() const;
+		static void transitionImage(
+			VkCommandBuffer commandBuffer,
+			VkImage image,
+			VkImageAspectFlags aspectMask,
+			VkImageLayout oldLayout,
+			VkImageLayout newLayout,
+			VkPipelineStageFlags srcStage,
+			VkAccessFlags srcAccess,
+			VkPipelineStageFlags dstStage,
+			VkAccessFlags dstAccess);
 
 		VeWindow& veWindow;
 		VeDevice& veDevice;
 		std::unique_ptr<VeSwapChain> veSwapChain;
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::unique_ptr<VeFrameAllocator> frameAllocator;
+		VeSwapChain::Config swapChainConfig;
+
+		std::unique_ptr<VeGpuProfiler> gpuProfiler;
 
 		uint32_t currentImageIndex{ 0 };
+		uint32_t swapChainGeneration{ 0 };
 		int currentFrameIndex{ 0 };
 		bool isFrameStarted{ false };
+		bool isMainSubpassStarted{ false };
+		bool isRenderPassSuspendable{ false };
 	};
 } // namespace ve
\ No newline at end of file
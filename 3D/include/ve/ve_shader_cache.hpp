@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ve_device.hpp"
+#include "ve_shader_reflection.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+
+namespace ve {
+
+	class VeShaderModule {
+	public:
+		VeShaderModule(VeDevice& device, const uint32_t* code, size_t codeSize, uint64_t contentHash);
+		~VeShaderModule();
+
+		VeShaderModule(const VeShaderModule&) = delete;
+		VeShaderModule& operator=(const VeShaderModule&) = delete;
+
+		VkShaderModule getShaderModule() const { return shaderModule; }
+		uint64_t getContentHash() const { return contentHash; }
+		// reflection failures don't stop the module from being used, they only throw here, when a layout
+		// is to be derived from it
+		bool isReflected() const { return reflection.has_value(); }
+		const ShaderReflection& getReflection() const;
+
+	private:
+		VeDevice& veDevice;
+		VkShaderModule shaderModule;
+		uint64_t contentHash;
+		std::optional<ShaderReflection> reflection;
+		std::string reflectionError;
+	};
+
+	// Registry of shader modules shared between pipelines. Each SPIR-V file is memory mapped and turned
+	// into one VkShaderModule per distinct content; the module lives as long as a pipeline references it.
+	class VeShaderCache {
+	public:
+		VeShaderCache(VeDevice& device) : veDevice{ device } {}
+
+		VeShaderCache(const VeShaderCache&) = delete;
+		VeShaderCache& operator=(const VeShaderCache&) = delete;
+
+		std::shared_ptr<VeShaderModule> getShaderModule(const std::string& filepath);
+
+	private:
+		struct Key {
+			std::string filepath;
+			uint64_t contentHash;
+
+			bool operator==(const Key& other) const {
+				return contentHash == other.contentHash && filepath == other.filepath;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		VeDevice& veDevice;
+
+		std::mutex cacheMutex;
+		std::unordered_map<Key, std::weak_ptr<VeShaderModule>, KeyHash> modules;
+	};
+} // namespace ve
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ve_pipeline.hpp"
+#include "ve_pipeline_cache.hpp"
+#include "ve_pipeline_compiler.hpp"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace ve {
+
+	// Pipeline whose shaders are watched by a VeShaderHotReloader. Render systems hold on to this
+	// instead of a VePipeline and bind through it; the underlying pipeline is swapped in update().
+	class VeReloadablePipeline {
+	public:
+		VeReloadablePipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
+
+		VeReloadablePipeline(const VeReloadablePipeline&) = delete;
+		VeReloadablePipeline& operator=(const VeReloadablePipeline&) = delete;
+
+		// returns false while the first compile is still running, or after it failed, and draws should be
+		// skipped; a failed first compile is replaced once a reload of the fixed shader succeeds
+		bool bind(VkCommandBuffer commandBuffer);
+		VePipeline* get();
+
+	private:
+		friend class VeShaderHotReloader;
+
+		bool usesShader(const std::string& spvFilepath) const;
+		// drops current if its compile failed, so the error is reported once instead of rethrown every draw
+		bool hasUsablePipeline();
+
+		std::string vertFilepath;
+		std::string fragFilepath;
+		PipelineConfigInfo configInfo;
+
+		std::shared_ptr<VeAsyncPipeline> current;
+		std::shared_ptr<VeAsyncPipeline> pending;
+	};
+
+	// Watches a shader source directory, recompiles changed GLSL to SPIR-V with glslc on a background
+	// thread and rebuilds the pipelines using it through a VePipelineCompiler. Call update() once per
+	// frame after beginFrame(); finished pipelines are swapped in there and the replaced ones are kept
+	// alive until every frame in flight that may still reference them has completed.
+	//
+	// Compiles write the same .spv.d depfiles as tools/compile_shaders.py, and a changed include only
+	// recompiles the stages whose depfile lists it. The .spv.json metadata of a reloaded stage is removed
+	// rather than left stale, so the next compile_shaders.py run rebuilds it.
+	class VeShaderHotReloader {
+	public:
+		VeShaderHotReloader(
+			VePipelineCompiler& compiler,
+			const std::string& shaderDirectory,
+			const std::string& glslcPath = "glslc",
+			VePipelineCache* pipelineCache = nullptr);
+		~VeShaderHotReloader();
+
+		VeShaderHotReloader(const VeShaderHotReloader&) = delete;
+		VeShaderHotReloader& operator=(const VeShaderHotReloader&) = delete;
+
+		// vertFilepath and fragFilepath are the compiled .spv files, sources are expected next to them
+		// following the "shader.vert" -> "shader.vert.spv" convention of tools/compile.bat
+		std::shared_ptr<VeReloadablePipeline> createPipeline(
+			const std::string& vertFilepath,
+			const std::string& fragFilepath,
+			const PipelineConfigInfo& configInfo);
+
+		void update();
+
+	private:
+		struct RetiredPipeline {
+			std::shared_ptr<VeAsyncPipeline> pipeline;
+			uint64_t releaseFrame;
+		};
+
+		void watchLoop();
+		void watchLoopPolling();
+		void handleChangedSources(const std::vector<std::string>& sources);
+		bool dependsOn(const std::string& sourceFilepath, const std::string& includeFilepath) const;
+		bool compileShader(const std::string& sourceFilepath);
+
+		VePipelineCompiler& veCompiler;
+		VePipelineCache* vePipelineCache;
+		std::string shaderDirectory;
+		std::string glslcPath;
+
+		std::vector<std::weak_ptr<VeReloadablePipeline>> pipelines;
+		std::deque<RetiredPipeline> retiredPipelines;
+		uint64_t frameCounter{ 0 };
+
+		// .spv files rewritten by the watcher thread and not yet picked up by update()
+		std::mutex compiledMutex;
+		std::vector<std::string> compiledShaders;
+
+		std::atomic<bool> stopping{ false };
+		std::thread watcher;
+	};
+} // namespace ve
@@ -0,0 +1,41 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+
+namespace ve {
+
+	// Resource interface of a single SPIR-V module, as declared by the shader source.
+	struct ShaderReflection {
+		struct VertexInput {
+			uint32_t location;
+			VkFormat format;
+			uint32_t size;
+		};
+
+		// descriptor count given to runtime sized arrays, which have none in SPIR-V. Layouts needing more
+		// should come from VePipelineLayoutCache::setExternalSetLayout()
+		static constexpr uint32_t RUNTIME_ARRAY_DESCRIPTOR_COUNT = 1;
+
+		VkShaderStageFlagBits stage{ VK_SHADER_STAGE_VERTEX_BIT };
+
+		// set -> binding -> layout binding, with stageFlags set to this stage
+		std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> descriptorSets;
+		std::optional<VkPushConstantRange> pushConstantRange;
+
+		// only filled for vertex shaders, sorted by location, built-ins excluded; matrix and array inputs
+		// appear once per location they occupy
+		std::vector<VertexInput> vertexInputs;
+
+		// throws for modules using types the reflection doesn't understand
+		static ShaderReflection reflect(const uint32_t* code, size_t codeSize);
+	};
+} // namespace ve
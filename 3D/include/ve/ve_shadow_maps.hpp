@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ve_camera.hpp"
+#include "ve_device.hpp"
+#include "ve_pipeline.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+
+
+namespace ve {
+
+	// std140/std430 layout shared with shaders/shadow.glsl
+	struct CascadeShadowData {
+		static constexpr uint32_t MAX_CASCADES = 4;
+
+		glm::mat4 worldToShadow[MAX_CASCADES]{};	// world space to atlas uv (xy) and depth (z)
+		glm::vec4 splitDepths{};					// view space far distance of each cascade
+		glm::vec4 params{};							// cascade count, 1 / atlas size
+		glm::vec4 tileBounds[MAX_CASCADES]{};		// atlas uv min (xy) and max (zw) for the filter taps
+	};
+
+	// Cascaded shadow maps for one directional light. The camera frustum is split into cascades whose
+	// bounding spheres are fitted with orthographic light cameras snapped to whole texels, and every cascade
+	// is a tile of one depth atlas rendered in a single depth-only render pass.
+	//
+	// Cascades from Config::firstCachedCascade on only hold static casters and keep their contents across
+	// frames until their light camera moves by a texel (or a depth step of half the caster padding) or
+	// invalidateCachedCascades() is called, so far cascades are rarely re-rendered. Usage per frame:
+	//
+	//   shadowMaps.update(camera, lightDirection);
+	//   shadowMaps.beginRenderPass(commandBuffer);
+	//   for each cascade where needsRender(cascade):
+	//     shadowMaps.beginCascade(commandBuffer, cascade);
+	//     draw casters for which shouldRenderCaster(...) with getCascadeViewProjection(cascade) * model
+	//   shadowMaps.endRenderPass(commandBuffer);
+	class VeShadowMaps {
+	public:
+		struct Config {
+			uint32_t cascadeCount = 4;
+			uint32_t atlasSize = 4096;
+
+			// blend between logarithmic (1) and uniform (0) split distances
+			float splitLambda = 0.75f;
+
+			// shadows end here, 0 uses the camera's far plane
+			float maxShadowDistance = 0.f;
+
+			// distance the light cameras are pulled back so casters outside the view still cast into it
+			float casterPadding = 50.f;
+
+			uint32_t firstCachedCascade = 2;
+
+			float depthBiasConstant = 1.25f;
+			float depthBiasSlope = 1.75f;
+		};
+
+		VeShadowMaps(VeDevice& device, const Config& config);
+		VeShadowMaps(VeDevice& device) : VeShadowMaps(device, Config{}) {}
+		~VeShadowMaps();
+
+		VeShadowMaps(const VeShadowMaps&) = delete;
+		VeShadowMaps& operator=(const VeShadowMaps&) = delete;
+
+		// refits the cascades to camera's perspective projection; lightDirection points from the light
+		void update(const VeCamera& camera, const glm::vec3& lightDirection);
+
+		// static casters or the light changed, re-render the cached cascades next frame
+		void invalidateCachedCascades();
+
+		bool needsRender(uint32_t cascade) const;
+		bool isCascadeCached(uint32_t cascade) const { return cascade >= config.firstCachedCascade; }
+
+		// sphere bounds test against the cascade's light camera, extended towards the light
+		bool isCasterVisible(uint32_t cascade, const glm::vec3& center, float radius) const;
+		bool shouldRenderCaster(uint32_t cascade, const glm::vec3& center, float radius, bool isStatic) const {
+			return (isStatic || !isCascadeCached(cascade)) && isCasterVisible(cascade, center, radius);
+		}
+
+		void beginRenderPass(VkCommandBuffer commandBuffer);
+		// sets viewport and scissor to the cascade's atlas tile and clears it
+		void beginCascade(VkCommandBuffer commandBuffer, uint32_t cascade);
+		void endRenderPass(VkCommandBuffer commandBuffer);
+
+		// depth-only state with depth bias and no color attachments for this render pass
+		void configurePipeline(PipelineConfigInfo& configInfo) const;
+
+		const glm::mat4& getCascadeViewProjection(uint32_t cascade) const { return cascades[cascade].viewProjection; }
+		const CascadeShadowData& getShadowData() const { return shadowData; }
+		uint32_t getCascadeCount() const { return config.cascadeCount; }
+
+		VkRenderPass getRenderPass() const { return renderPass; }
+		VkDescriptorImageInfo descriptorInfo() const {
+			return VkDescriptorImageInfo{ sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		}
+
+	private:
+		struct Cascade {
+			glm::mat4 view{ 1.f };
+			glm::mat4 viewProjection{ 1.f };
+			glm::mat4 renderedViewProjection{ 0.f };
+			float radius = 0.f;
+			float depthRange = 0.f;
+			VkRect2D region{};
+			bool rendered = false;
+		};
+
+		void createAtlas();
+		void createRenderPass();
+		void createFramebuffer();
+		void createSampler();
+
+		VeDevice& veDevice;
+		Config config;
+		uint32_t cascadeResolution;
+
+		VkFormat depthFormat;
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkSampler sampler = VK_NULL_HANDLE;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+
+		std::array<Cascade, CascadeShadowData::MAX_CASCADES> cascades{};
+		CascadeShadowData shadowData{};
+		glm::vec3 lightDirection{ 0.f };
+	};
+} // namespace ve
@@ -16,18 +16,64 @@ namespace ve {
     public:
         static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-        VeSwapChain(VeDevice& deviceRef, VkExtent2D windowExtent);
-        VeSwapChain(VeDevice& deviceRef, VkExtent2D windowExtent, std::shared_ptr<VeSwapChain> previous);
+        static constexpr uint32_t DEPTH_PREPASS_SUBPASS = 0;
+
+        struct Config {
+            // with a depth pre-pass the render pass has a depth-only subpass before the main one
+            bool depthPrePass = false;
+
+            // keep depth in sampleable memory for compute between a suspended and resumed render pass,
+            // e.g. VeHiZCulling; otherwise depth is a transient attachment that may never leave tile memory
+            bool sampledDepth = false;
+
+            // samples per pixel, clamped to VeDevice::getMaxUsableSampleCount(). Above 1 the main subpass
+            // renders into transient multisampled color and depth that are resolved into the swap chain
+            // image at its end, so only the resolved image is written to memory. Not combinable with
+            // sampledDepth
+            VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+
+            // no VkRenderPass or framebuffers: VeRenderer records VK_KHR_dynamic_rendering straight into the
+            // images and transitions them itself. Needs VeDevice::supportsDynamicRendering()
+            bool dynamicRendering = false;
+
+            bool operator==(const Config& other) const {
+                return depthPrePass == other.depthPrePass && sampledDepth == other.sampledDepth &&
+                       msaaSamples == other.msaaSamples && dynamicRendering == other.dynamicRendering;
+            }
+        };
+
+        VeSwapChain(VeDevice& deviceRef, VkExtent2D windowExtent, const Config& config);
+        VeSwapChain(VeDevice& deviceRef, VkExtent2D windowExtent) : VeSwapChain(deviceRef, windowExtent, Config{}) {}
+        VeSwapChain(
+            VeDevice& deviceRef,
+            VkExtent2D windowExtent,
+            std::shared_ptr<VeSwapChain> previous,
+            const Config& config);
         ~VeSwapChain();
 
         VeSwapChain(const VeSwapChain&) = delete;
         VeSwapChain& operator=(const VeSwapChain&) = delete;
 
+        // neither exists with Config::dynamicRendering, getRenderPass() is then VK_NULL_HANDLE
         VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
         VkRenderPass getRenderPass() { return renderPass; }
+
+        // the render pass split in two around compute work reading its depth: the suspending pass stores
+        // depth and leaves it in SHADER_READ_ONLY_OPTIMAL, the resuming pass loads color and depth back;
+        // both are compatible with getRenderPass(), its framebuffers and its pipelines
+        VkRenderPass getSuspendingRenderPass() { return suspendingRenderPass; }
+        VkRenderPass getResumingRenderPass() { return resumingRenderPass; }
+        // one depth image shared by all frames, only sampleable with Config::sampledDepth
+        VkImage getDepthImage() { return depthImage; }
+        VkImageView getDepthImageView() { return depthImageView; }
+        // multisampled color target, VK_NULL_HANDLE without MSAA
+        VkImage getColorImage() { return colorImage; }
+        VkImageView getColorImageView() { return colorImageView; }
+        VkImage getImage(int index) { return swapChainImages[index]; }
         VkImageView getImageView(int index) { return swapChainImageViews[index]; }
         size_t imageCount() { return swapChainImages.size(); }
         VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
+        VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
         VkExtent2D getSwapChainExtent() { return swapChainExtent; }
         uint32_t width() { return swapChainExtent.width; }
         uint32_t height() { return swapChainExtent.height; }
@@ -37,20 +83,29 @@ namespace ve {
         }
         VkFormat findDepthFormat();
 
+        const Config& getConfig() const { return config; }
+        bool hasDepthPrePass() const { return config.depthPrePass; }
+        // the count pipelines drawing into the render pass must rasterize with
+        VkSampleCountFlagBits getMsaaSamples() const { return msaaSamples; }
+        uint32_t getMainSubpass() const { return config.depthPrePass ? 1 : 0; }
+
         VkResult acquireNextImage(uint32_t* imageIndex);
         VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
 
 		bool compareSwapFormats(const VeSwapChain& swapChain) const {
 			return swapChain.swapChainDepthFormat == swapChainDepthFormat && 
-                   swapChain.swapChainImageFormat == swapChainImageFormat;
+                   swapChain.swapChainImageFormat == swapChainImageFormat &&
+                   swapChain.config == config;
 		}
 
     private:
 		void init();
         void createSwapChain();
         void createImageViews();
+        void createColorResources();
         void createDepthResources();
-        void createRenderPass();
+        enum class RenderPassStage { Complete, Suspending, Resuming };
+        VkRenderPass createRenderPass(RenderPassStage stage);
         void createFramebuffers();
         void createSyncObjects();
 
@@ -66,16 +121,25 @@ namespace ve {
         VkExtent2D swapChainExtent;
 
         std::vector<VkFramebuffer> swapChainFramebuffers;
-        VkRenderPass renderPass;
-
-        std::vector<VkImage> depthImages;
-        std::vector<VkDeviceMemory> depthImageMemorys;
-        std::vector<VkImageView> depthImageViews;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkRenderPass suspendingRenderPass = VK_NULL_HANDLE;
+        VkRenderPass resumingRenderPass = VK_NULL_HANDLE;
+
+        VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        // multisampled color target, only with msaaSamples above 1
+        VkImage colorImage = VK_NULL_HANDLE;
+        VkDeviceMemory colorImageMemory = VK_NULL_HANDLE;
+        VkImageView colorImageView = VK_NULL_HANDLE;
+
+        VkImage depthImage;
+        VkDeviceMemory depthImageMemory;
+        VkImageView depthImageView;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
 
         VeDevice& device;
         VkExtent2D windowExtent;
+        Config config;
 
         VkSwapchainKHR swapChain;
 		std::shared_ptr<VeSwapChain> oldSwapChain;
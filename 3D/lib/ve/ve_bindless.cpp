@@ -0,0 +1,164 @@
+#include "ve/ve_bindless.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+
+namespace ve {
+
+	// ******************************	Bindless Handle Allocator	*************************************** //
+	uint32_t VeBindlessHandleAllocator::allocate() {
+		if (!freeHandles.empty()) {
+			uint32_t handle = freeHandles.back();
+			freeHandles.pop_back();
+			return handle;
+		}
+		if (nextHandle >= capacity) {
+			throw std::runtime_error("bindless descriptor array is full!");
+		}
+		return nextHandle++;
+	}
+
+	void VeBindlessHandleAllocator::release(uint32_t handle) {
+		assert(handle < nextHandle && "Releasing a bindless handle that was never allocated");
+		retiredHandles.push_back({ handle, frameCounter + VeSwapChain::MAX_FRAMES_IN_FLIGHT });
+	}
+
+	void VeBindlessHandleAllocator::nextFrame() {
+		frameCounter++;
+		while (!retiredHandles.empty() && retiredHandles.front().releaseFrame <= frameCounter) {
+			freeHandles.push_back(retiredHandles.front().handle);
+			retiredHandles.pop_front();
+		}
+	}
+
+
+	// ******************************	Bindless Descriptors	*************************************** //
+	VeBindlessDescriptors::VeBindlessDescriptors(
+		VeDevice& device,
+		uint32_t maxStorageBuffers,
+		uint32_t maxSampledImages,
+		uint32_t maxSamplers)
+		: veDevice{ device },
+		storageBufferHandles{ std::min({ maxStorageBuffers,
+			device.descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+			device.descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers }) },
+		sampledImageHandles{ std::min({ maxSampledImages,
+			device.descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+			device.descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages }) },
+		samplerHandles{ std::min({ maxSamplers,
+			device.descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+			device.descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers }) } {
+		if (!veDevice.supportsBindless()) {
+			throw std::runtime_error("bindless descriptors are not supported by this device!");
+		}
+
+		// every binding is visible to all stages, so the buffer and image arrays together must also fit the
+		// per stage resource limit (samplers don't count towards it); scaling them down keeps the requested
+		// proportions, and each keeps at least one slot since a pool size of 0 is invalid
+		const uint64_t totalResources =
+			static_cast<uint64_t>(storageBufferHandles.getCapacity()) + sampledImageHandles.getCapacity();
+		const uint32_t maxResources = veDevice.descriptorIndexingProperties.maxPerStageUpdateAfterBindResources;
+		if (totalResources > maxResources) {
+			auto scaled = [&](const VeBindlessHandleAllocator& handles) {
+				uint64_t capacity = static_cast<uint64_t>(handles.getCapacity()) * maxResources / totalResources;
+				return std::max(static_cast<uint32_t>(capacity), 1u);
+			};
+			storageBufferHandles = VeBindlessHandleAllocator{ scaled(storageBufferHandles) };
+			sampledImageHandles = VeBindlessHandleAllocator{ scaled(sampledImageHandles) };
+		}
+
+		// slots may be written while the set is bound and unused slots may hold stale descriptors
+		const VkDescriptorBindingFlags bindingFlags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+		const VkShaderStageFlags stages = VK_SHADER_STAGE_ALL;
+
+		setLayout = VeDescriptorSetLayout::Builder(veDevice)
+			.setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+			.addBinding(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages, storageBufferHandles.getCapacity(), bindingFlags)
+			.addBinding(SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, stages, sampledImageHandles.getCapacity(), bindingFlags)
+			.addBinding(SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, stages, samplerHandles.getCapacity(), bindingFlags)
+			.build();
+
+		pool = VeDescriptorPool::Builder(veDevice)
+			.setMaxSets(1)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBufferHandles.getCapacity())
+			.addPoolSize(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, sampledImageHandles.getCapacity())
+			.addPoolSize(VK_DESCRIPTOR_TYPE_SAMPLER, samplerHandles.getCapacity())
+			.build();
+
+		if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+			throw std::runtime_error("failed to allocate bindless descriptor set!");
+		}
+	}
+
+	uint32_t VeBindlessDescriptors::addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo) {
+		uint32_t handle = storageBufferHandles.allocate();
+		updateStorageBuffer(handle, bufferInfo);
+		return handle;
+	}
+
+	uint32_t VeBindlessDescriptors::addSampledImage(VkImageView imageView, VkImageLayout imageLayout) {
+		uint32_t handle = sampledImageHandles.allocate();
+		updateSampledImage(handle, imageView, imageLayout);
+		return handle;
+	}
+
+	uint32_t VeBindlessDescriptors::addSampler(VkSampler sampler) {
+		uint32_t handle = samplerHandles.allocate();
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = sampler;
+		write(SAMPLER_BINDING, handle, VK_DESCRIPTOR_TYPE_SAMPLER, nullptr, &imageInfo);
+		return handle;
+	}
+
+	void VeBindlessDescriptors::updateStorageBuffer(uint32_t handle, const VkDescriptorBufferInfo& bufferInfo) {
+		write(STORAGE_BUFFER_BINDING, handle, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfo, nullptr);
+	}
+
+	void VeBindlessDescriptors::updateSampledImage(uint32_t handle, VkImageView imageView, VkImageLayout imageLayout) {
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageView = imageView;
+		imageInfo.imageLayout = imageLayout;
+		write(SAMPLED_IMAGE_BINDING, handle, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, nullptr, &imageInfo);
+	}
+
+	void VeBindlessDescriptors::nextFrame() {
+		storageBufferHandles.nextFrame();
+		sampledImageHandles.nextFrame();
+		samplerHandles.nextFrame();
+	}
+
+	void VeBindlessDescriptors::bind(
+		VkCommandBuffer commandBuffer,
+		VkPipelineLayout pipelineLayout,
+		uint32_t set,
+		VkPipelineBindPoint bindPoint) const {
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &descriptorSet, 0, nullptr);
+	}
+
+	void VeBindlessDescriptors::write(
+		uint32_t binding,
+		uint32_t handle,
+		VkDescriptorType type,
+		const VkDescriptorBufferInfo* bufferInfo,
+		const VkDescriptorImageInfo* imageInfo) {
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = binding;
+		write.dstArrayElement = handle;
+		write.descriptorCount = 1;
+		write.descriptorType = type;
+		write.pBufferInfo = bufferInfo;
+		write.pImageInfo = imageInfo;
+		vkUpdateDescriptorSets(veDevice.device(), 1, &write, 0, nullptr);
+	}
+
+} // namespace ve
@@ -0,0 +1,207 @@
+#include "ve/ve_clustered_lighting.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace ve {
+
+	VeClusteredLighting::VeClusteredLighting(VeDevice& device, VeLightBuffer& lightBuffer, const Config& config)
+		: veDevice{ device }, lightBuffer{ lightBuffer }, config{ config } {
+		assert(config.tilesX > 0 && config.tilesY > 0 && config.depthSlices > 0 && "Cluster grid must not be empty");
+
+		setLayout = VeDescriptorSetLayout::Builder(veDevice)
+			.addBinding(LIGHTS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(CLUSTER_GRID_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(LIGHT_INDICES_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build();
+
+		descriptorPool = VeDescriptorPool::Builder(veDevice)
+			.setMaxSets(VeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * VeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+
+		frames.resize(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+		for (int frameIndex = 0; frameIndex < VeSwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++) {
+			auto& frame = frames[frameIndex];
+			frame.clusterGridBuffer = createMappedStorageBuffer(
+				sizeof(ClusterGridHeader) + sizeof(glm::uvec2) * getClusterCount(), 1);
+			frame.lightIndexBuffer = createMappedStorageBuffer(sizeof(uint32_t), std::max(config.maxLightIndices, 1u));
+
+			auto lightInfo = lightBuffer.descriptorInfo(frameIndex);
+			frame.boundLightBuffer = lightInfo.buffer;
+			auto gridInfo = frame.clusterGridBuffer->descriptorInfo();
+			auto indexInfo = frame.lightIndexBuffer->descriptorInfo();
+			if (!VeDescriptorWriter(*setLayout, *descriptorPool)
+				.writeBuffer(LIGHTS_BINDING, &lightInfo)
+				.writeBuffer(CLUSTER_GRID_BINDING, &gridInfo)
+				.writeBuffer(LIGHT_INDICES_BINDING, &indexInfo)
+				.build(frame.descriptorSet)) {
+				throw std::runtime_error("failed to allocate clustered lighting descriptor set!");
+			}
+		}
+
+		clusterCounts.resize(getClusterCount());
+		clusterRanges.resize(getClusterCount());
+	}
+
+	std::unique_ptr<VeBuffer> VeClusteredLighting::createMappedStorageBuffer(VkDeviceSize instanceSize, uint32_t instanceCount) {
+		auto buffer = std::make_unique<VeBuffer>(
+			veDevice,
+			instanceSize,
+			instanceCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (buffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map clustered lighting buffer!");
+		}
+		return buffer;
+	}
+
+	void VeClusteredLighting::update(int frameIndex, const VeCamera& camera, VkExtent2D extent) {
+		const glm::mat4& projection = camera.getProjection();
+		const glm::mat4& view = camera.getView();
+		assert(projection[2][3] == 1.f && "Clustered lighting needs a perspective projection");
+
+		// near and far planes recovered from VeCamera::setPerspectiveProjection's matrix
+		const float nearPlane = -projection[3][2] / projection[2][2];
+		const float farPlane = projection[3][2] / (1.f - projection[2][2]);
+
+		// slice = log(z) * scale + bias gives exponentially deeper slices further from the camera
+		const float sliceScale = config.depthSlices / std::log(farPlane / nearPlane);
+		const float sliceBias = -std::log(nearPlane) * sliceScale;
+
+		auto& frame = frames[frameIndex];
+		lightBuffer.flush(frameIndex);
+
+		// the light buffer reallocates when it grows, the frame's set is idle so it can be rewritten
+		auto lightInfo = lightBuffer.descriptorInfo(frameIndex);
+		if (lightInfo.buffer != frame.boundLightBuffer) {
+			VeDescriptorWriter(*setLayout, *descriptorPool)
+				.writeBuffer(LIGHTS_BINDING, &lightInfo)
+				.overwrite(frame.descriptorSet);
+			frame.boundLightBuffer = lightInfo.buffer;
+		}
+
+		const auto& lights = lightBuffer.getLights();
+		uint32_t lightCount = lightBuffer.getLightCount();
+
+		// pass 1: clusters touched by each light
+		std::fill(clusterCounts.begin(), clusterCounts.end(), 0);
+		boundsScratch.resize(lightCount);
+		for (uint32_t i = 0; i < lightCount; i++) {
+			glm::vec3 viewPosition = glm::vec3(view * glm::vec4(glm::vec3(lights[i].position), 1.f));
+			ClusterBounds& bounds = boundsScratch[i];
+			if (!computeClusterBounds(viewPosition, lights[i].position.w, projection, sliceScale, sliceBias, bounds)) {
+				// empty range so pass 3 skips the light too
+				bounds.min = glm::uvec3(1);
+				bounds.max = glm::uvec3(0);
+				continue;
+			}
+			for (uint32_t z = bounds.min.z; z <= bounds.max.z; z++) {
+				for (uint32_t y = bounds.min.y; y <= bounds.max.y; y++) {
+					for (uint32_t x = bounds.min.x; x <= bounds.max.x; x++) {
+						clusterCounts[(z * config.tilesY + y) * config.tilesX + x]++;
+					}
+				}
+			}
+		}
+
+		// pass 2: prefix sum into per cluster ranges, clusters past the index capacity lose lights
+		uint32_t offset = 0;
+		droppedLightIndices = 0;
+		for (uint32_t cluster = 0; cluster < getClusterCount(); cluster++) {
+			uint32_t count = std::min(clusterCounts[cluster], config.maxLightIndices - offset);
+			droppedLightIndices += clusterCounts[cluster] - count;
+			clusterRanges[cluster] = { offset, count };
+			offset += count;
+			clusterCounts[cluster] = 0;
+		}
+
+		// pass 3: scatter light indices, clusterCounts is reused as the fill cursor
+		auto* indices = static_cast<uint32_t*>(frame.lightIndexBuffer->getMappedMemory());
+		for (uint32_t i = 0; i < lightCount; i++) {
+			const ClusterBounds& bounds = boundsScratch[i];
+			for (uint32_t z = bounds.min.z; z <= bounds.max.z; z++) {
+				for (uint32_t y = bounds.min.y; y <= bounds.max.y; y++) {
+					for (uint32_t x = bounds.min.x; x <= bounds.max.x; x++) {
+						uint32_t cluster = (z * config.tilesY + y) * config.tilesX + x;
+						if (clusterCounts[cluster] < clusterRanges[cluster].y) {
+							indices[clusterRanges[cluster].x + clusterCounts[cluster]++] = i;
+						}
+					}
+				}
+			}
+		}
+
+		ClusterGridHeader header{};
+		header.gridSize = { config.tilesX, config.tilesY, config.depthSlices, lightCount };
+		header.screenParams = { static_cast<float>(extent.width), static_cast<float>(extent.height), sliceScale, sliceBias };
+		auto* gridMemory = static_cast<char*>(frame.clusterGridBuffer->getMappedMemory());
+		memcpy(gridMemory, &header, sizeof(header));
+		memcpy(gridMemory + sizeof(header), clusterRanges.data(), clusterRanges.size() * sizeof(glm::uvec2));
+	}
+
+	bool VeClusteredLighting::computeClusterBounds(
+		const glm::vec3& viewPosition,
+		float range,
+		const glm::mat4& projection,
+		float sliceScale,
+		float sliceBias,
+		ClusterBounds& bounds) const {
+		const float nearPlane = -projection[3][2] / projection[2][2];
+		const float farPlane = projection[3][2] / (1.f - projection[2][2]);
+
+		float zMin = std::max(viewPosition.z - range, nearPlane);
+		float zMax = std::min(viewPosition.z + range, farPlane);
+		if (zMin > zMax) {
+			return false;
+		}
+
+		// the projected x and y of a box corner are extreme at its nearest or farthest depth, so the
+		// corners of the sphere's view space box give a conservative screen rectangle
+		glm::vec2 ndcMin{ 1.f };
+		glm::vec2 ndcMax{ -1.f };
+		for (float z : { zMin, zMax }) {
+			for (float dx : { -range, range }) {
+				for (float dy : { -range, range }) {
+					glm::vec4 clip = projection * glm::vec4(viewPosition.x + dx, viewPosition.y + dy, z, 1.f);
+					glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+					ndcMin = glm::min(ndcMin, ndc);
+					ndcMax = glm::max(ndcMax, ndc);
+				}
+			}
+		}
+		if (ndcMin.x > 1.f || ndcMin.y > 1.f || ndcMax.x < -1.f || ndcMax.y < -1.f) {
+			return false;
+		}
+
+		auto toTile = [](float ndc, uint32_t tiles) {
+			float tile = (ndc * 0.5f + 0.5f) * tiles;
+			return static_cast<uint32_t>(std::clamp(tile, 0.f, static_cast<float>(tiles - 1)));
+		};
+		auto toSlice = [&](float z) {
+			float slice = std::log(z) * sliceScale + sliceBias;
+			return static_cast<uint32_t>(std::clamp(slice, 0.f, static_cast<float>(config.depthSlices - 1)));
+		};
+
+		bounds.min = { toTile(ndcMin.x, config.tilesX), toTile(ndcMin.y, config.tilesY), toSlice(zMin) };
+		bounds.max = { toTile(ndcMax.x, config.tilesX), toTile(ndcMax.y, config.tilesY), toSlice(zMax) };
+		return true;
+	}
+
+	void VeClusteredLighting::bind(
+		VkCommandBuffer commandBuffer,
+		int frameIndex,
+		VkPipelineLayout pipelineLayout,
+		uint32_t set,
+		VkPipelineBindPoint bindPoint) const {
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &frames[frameIndex].descriptorSet, 0, nullptr);
+	}
+
+} // namespace ve
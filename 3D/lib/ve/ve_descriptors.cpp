@@ -1,17 +1,42 @@
 #include "ve/ve_descriptors.hpp"
+#include "ve/ve_utils.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 
 namespace ve {
 
+	namespace {
+
+		bool isBufferDescriptor(VkDescriptorType type) {
+			return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+				type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		}
+
+		bool isTexelBufferDescriptor(VkDescriptorType type) {
+			return type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+		}
+
+		// size of the info struct one descriptor of this type is written from
+		size_t descriptorInfoSize(VkDescriptorType type) {
+			if (isBufferDescriptor(type)) return sizeof(VkDescriptorBufferInfo);
+			if (isTexelBufferDescriptor(type)) return sizeof(VkBufferView);
+			return sizeof(VkDescriptorImageInfo);
+		}
+
+	} // namespace
+
 	// ******************************	Descriptor Set Layout Builder	*************************************** //
 	VeDescriptorSetLayout::Builder& VeDescriptorSetLayout::Builder::addBinding(
 		uint32_t binding,
 		VkDescriptorType descriptorType,
 		VkShaderStageFlags stageFlags,
-		uint32_t count) {
+		uint32_t count,
+		VkDescriptorBindingFlags flags) {
 		assert(bindings.count(binding) == 0 && "Binding already in use");
 		VkDescriptorSetLayoutBinding layoutBinding{};
 		layoutBinding.binding = binding;
@@ -19,28 +44,62 @@ namespace ve {
 		layoutBinding.descriptorCount = count;
 		layoutBinding.stageFlags = stageFlags;
 		bindings[binding] = layoutBinding;
+		if (flags != 0) {
+			bindingFlags[binding] = flags;
+		}
+		return *this;
+	}
+
+	VeDescriptorSetLayout::Builder& VeDescriptorSetLayout::Builder::setLayoutFlags(
+		VkDescriptorSetLayoutCreateFlags flags) {
+		layoutFlags = flags;
 		return *this;
 	}
 
 	std::unique_ptr<VeDescriptorSetLayout> VeDescriptorSetLayout::Builder::build() const {
-		return std::make_unique<VeDescriptorSetLayout>(veDevice, bindings);
+		return std::make_unique<VeDescriptorSetLayout>(veDevice, bindings, layoutFlags, bindingFlags);
+	}
+
+	VeDescriptorSetLayout& VeDescriptorSetLayout::Builder::build(VeDescriptorSetLayoutCache& cache) const {
+		assert(layoutFlags == 0 && bindingFlags.empty() && "Descriptor set layout cache only holds plain layouts");
+		std::vector<VkDescriptorSetLayoutBinding> bindingList{};
+		for (auto& kv : bindings) {
+			bindingList.push_back(kv.second);
+		}
+		return cache.getLayout(bindingList);
 	}
 
 
 	// ******************************	Descriptor Set Layout	*************************************** //
 	VeDescriptorSetLayout::VeDescriptorSetLayout(
-		VeDevice& veDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+		VeDevice& veDevice,
+		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+		VkDescriptorSetLayoutCreateFlags layoutFlags,
+		const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags)
 		: veDevice{ veDevice }, bindings{ bindings } {
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+		std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
 		for (auto kv : bindings) {
 			setLayoutBindings.push_back(kv.second);
+			auto flags = bindingFlags.find(kv.first);
+			setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
 		}
 
 		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
 		descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descriptorSetLayoutInfo.flags = layoutFlags;
 		descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
 		descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+		// binding flags need descriptor indexing, leave the chain empty for plain layouts
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		if (!bindingFlags.empty()) {
+			bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+			bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+			bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+			descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+		}
+
 		if (vkCreateDescriptorSetLayout(
 				veDevice.device(),
 				&descriptorSetLayoutInfo,
@@ -109,8 +168,7 @@ namespace ve {
 		allocInfo.pSetLayouts = &descriptorSetLayout;
 		allocInfo.descriptorSetCount = 1;
 
-		// Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-		// a new pool whenever an old pool fills up. But this is beyond our current scope
+		// fails with VK_ERROR_OUT_OF_POOL_MEMORY once full, VeDescriptorPoolManager grows past that
 		if (vkAllocateDescriptorSets(veDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
 			return false;
 		}
@@ -130,54 +188,356 @@ namespace ve {
 	}
 
 
+	// ******************************	Descriptor Pool Manager Builder	*************************************** //
+	VeDescriptorPoolManager::Builder& VeDescriptorPoolManager::Builder::addPoolRatio(
+		VkDescriptorType descriptorType, float count) {
+		poolRatios.push_back({ descriptorType, count });
+		return *this;
+	}
+
+	VeDescriptorPoolManager::Builder& VeDescriptorPoolManager::Builder::setPoolFlags(
+		VkDescriptorPoolCreateFlags flags) {
+		poolFlags = flags;
+		return *this;
+	}
+
+	VeDescriptorPoolManager::Builder& VeDescriptorPoolManager::Builder::setInitialSetsPerPool(uint32_t count) {
+		initialSetsPerPool = count;
+		return *this;
+	}
+
+	std::unique_ptr<VeDescriptorPoolManager> VeDescriptorPoolManager::Builder::build() const {
+		return std::make_unique<VeDescriptorPoolManager>(veDevice, initialSetsPerPool, poolFlags, poolRatios);
+	}
+
+
+	// ******************************	Descriptor Pool Manager		*************************************** //
+	VeDescriptorPoolManager::VeDescriptorPoolManager(
+		VeDevice& veDevice,
+		uint32_t initialSetsPerPool,
+		VkDescriptorPoolCreateFlags poolFlags,
+		const std::vector<std::pair<VkDescriptorType, float>>& poolRatios)
+		: veDevice{ veDevice },
+		poolRatios{ poolRatios },
+		poolFlags{ poolFlags },
+		nextSetsPerPool{ std::min(std::max(initialSetsPerPool, 1u), MAX_SETS_PER_POOL) } {
+		assert(!poolRatios.empty() && "Descriptor pool manager needs at least one pool ratio");
+	}
+
+	VeDescriptorPoolManager::Pool VeDescriptorPoolManager::acquirePool() {
+		if (!freePools.empty()) {
+			Pool pool = std::move(freePools.back());
+			freePools.pop_back();
+			return pool;
+		}
+
+		// each new pool is larger than the last, so heavy users quickly settle on a few big pools
+		uint32_t maxSets = nextSetsPerPool;
+		nextSetsPerPool = std::min(nextSetsPerPool * 2, MAX_SETS_PER_POOL);
+
+		std::vector<VkDescriptorPoolSize> poolSizes{};
+		for (auto& [descriptorType, ratio] : poolRatios) {
+			poolSizes.push_back({ descriptorType, static_cast<uint32_t>(std::ceil(ratio * maxSets)) });
+		}
+
+		return Pool{ std::make_unique<VeDescriptorPool>(veDevice, maxSets, poolFlags, poolSizes), PoolUsage{ 0, maxSets } };
+	}
+
+	bool VeDescriptorPoolManager::allocateDescriptor(
+		const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) {
+		if (!usedPools.empty() && usedPools.back().pool->allocateDescriptor(descriptorSetLayout, descriptor)) {
+			usedPools.back().usage.allocatedSets++;
+			return true;
+		}
+
+		// a pool that can't fit the layout even when empty goes back unused, so failures don't leak pools
+		Pool pool = acquirePool();
+		if (!pool.pool->allocateDescriptor(descriptorSetLayout, descriptor)) {
+			freePools.push_back(std::move(pool));
+			return false;
+		}
+		pool.usage.allocatedSets++;
+		usedPools.push_back(std::move(pool));
+		return true;
+	}
+
+	void VeDescriptorPoolManager::resetPools() {
+		for (auto& pool : usedPools) {
+			pool.pool->resetPool();
+			pool.usage.allocatedSets = 0;
+			freePools.push_back(std::move(pool));
+		}
+		usedPools.clear();
+	}
+
+	std::vector<VeDescriptorPoolManager::PoolUsage> VeDescriptorPoolManager::getPoolUsage() const {
+		std::vector<PoolUsage> usage{};
+		for (auto& pool : usedPools) {
+			usage.push_back(pool.usage);
+		}
+		for (auto& pool : freePools) {
+			usage.push_back(pool.usage);
+		}
+		return usage;
+	}
+
+	uint32_t VeDescriptorPoolManager::getAllocatedSetCount() const {
+		uint32_t count = 0;
+		for (auto& pool : usedPools) {
+			count += pool.usage.allocatedSets;
+		}
+		return count;
+	}
+
+
+	// ******************************	Descriptor Set Layout Cache	*************************************** //
+	bool VeDescriptorSetLayoutCache::LayoutKey::operator==(const LayoutKey& other) const {
+		if (bindings.size() != other.bindings.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < bindings.size(); i++) {
+			auto& a = bindings[i];
+			auto& b = other.bindings[i];
+			if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount ||
+				a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t VeDescriptorSetLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+		size_t seed = 0;
+		for (auto& binding : key.bindings) {
+			hashCombine(seed, binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags);
+		}
+		return seed;
+	}
+
+	VeDescriptorSetLayout& VeDescriptorSetLayoutCache::getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+		LayoutKey key{ bindings };
+		std::sort(key.bindings.begin(), key.bindings.end(),
+			[](const auto& a, const auto& b) { return a.binding < b.binding; });
+
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		auto& layout = layouts[key];
+		if (layout == nullptr) {
+			std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindingMap{};
+			for (auto& binding : key.bindings) {
+				assert(bindingMap.count(binding.binding) == 0 && "Binding already in use");
+				bindingMap[binding.binding] = binding;
+			}
+			layout = std::make_unique<VeDescriptorSetLayout>(veDevice, bindingMap);
+		}
+		return *layout;
+	}
+
+	size_t VeDescriptorSetLayoutCache::size() {
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		return layouts.size();
+	}
+
+
+	// ******************************	Descriptor Set Cache	*************************************** //
+	VeDescriptorSetCache::VeDescriptorSetCache(
+		VeDevice& veDevice,
+		const std::vector<std::pair<VkDescriptorType, float>>& poolRatios)
+		: veDevice{ veDevice }, poolManager{ veDevice, 256, 0, poolRatios } {}
+
+	size_t VeDescriptorSetCache::SetKeyHash::operator()(const SetKey& key) const {
+		size_t seed = 0;
+		for (auto word : key) {
+			hashCombine(seed, word);
+		}
+		return seed;
+	}
+
+	bool VeDescriptorSetCache::getDescriptorSet(
+		VkDescriptorSetLayout setLayout,
+		std::vector<VkWriteDescriptorSet>& writes,
+		VkDescriptorSet& set) {
+		SetKey key{ (uint64_t)setLayout };
+		for (auto& write : writes) {
+			key.insert(key.end(), { write.dstBinding, write.dstArrayElement, write.descriptorCount, static_cast<uint64_t>(write.descriptorType) });
+			for (uint32_t i = 0; i < write.descriptorCount; i++) {
+				if (write.pBufferInfo != nullptr) {
+					auto& info = write.pBufferInfo[i];
+					key.insert(key.end(), { (uint64_t)info.buffer, info.offset, info.range });
+				}
+				if (write.pImageInfo != nullptr) {
+					auto& info = write.pImageInfo[i];
+					key.insert(key.end(), { (uint64_t)info.sampler, (uint64_t)info.imageView, static_cast<uint64_t>(info.imageLayout) });
+				}
+				if (write.pTexelBufferView != nullptr) {
+					key.push_back((uint64_t)write.pTexelBufferView[i]);
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		auto it = sets.find(key);
+		if (it != sets.end()) {
+			set = it->second;
+			return true;
+		}
+
+		if (!poolManager.allocateDescriptor(setLayout, set)) {
+			return false;
+		}
+		for (auto& write : writes) {
+			write.dstSet = set;
+		}
+		vkUpdateDescriptorSets(veDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+		sets.emplace(std::move(key), set);
+		return true;
+	}
+
+	void VeDescriptorSetCache::clear() {
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		sets.clear();
+		poolManager.resetPools();
+	}
+
+	size_t VeDescriptorSetCache::size() {
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		return sets.size();
+	}
+
+
+	// ******************************	Descriptor Update Template	*************************************** //
+	VeDescriptorUpdateTemplate::VeDescriptorUpdateTemplate(
+		VeDevice& veDevice,
+		VkDescriptorSetLayout setLayout,
+		const std::vector<VkDescriptorUpdateTemplateEntry>& entries,
+		size_t dataSize)
+		: veDevice{ veDevice }, entries{ entries }, dataSize{ dataSize } {
+		if (veDevice.apiVersion() < VK_API_VERSION_1_1) {
+			return;
+		}
+
+		VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+		templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+		templateInfo.pDescriptorUpdateEntries = entries.data();
+		templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateInfo.descriptorSetLayout = setLayout;
+
+		if (vkCreateDescriptorUpdateTemplate(veDevice.device(), &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor update template!");
+		}
+	}
+
+	VeDescriptorUpdateTemplate::~VeDescriptorUpdateTemplate() {
+		if (updateTemplate != VK_NULL_HANDLE) {
+			vkDestroyDescriptorUpdateTemplate(veDevice.device(), updateTemplate, nullptr);
+		}
+	}
+
+	void VeDescriptorUpdateTemplate::update(VkDescriptorSet set, const void* data) const {
+		if (updateTemplate != VK_NULL_HANDLE) {
+			vkUpdateDescriptorSetWithTemplate(veDevice.device(), set, updateTemplate, data);
+			return;
+		}
+
+		// vkUpdateDescriptorSets needs tightly packed infos, entries with any other stride are packed first
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		std::vector<std::vector<uint8_t>> packedInfos{};
+		std::vector<VkWriteDescriptorSet> writes{};
+		for (auto& entry : entries) {
+			const uint8_t* infos = bytes + entry.offset;
+			const size_t infoSize = descriptorInfoSize(entry.descriptorType);
+			if (entry.descriptorCount > 1 && entry.stride != infoSize) {
+				auto& packed = packedInfos.emplace_back(infoSize * entry.descriptorCount);
+				for (uint32_t i = 0; i < entry.descriptorCount; i++) {
+					memcpy(packed.data() + i * infoSize, infos + i * entry.stride, infoSize);
+				}
+				infos = packed.data();
+			}
+
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = set;
+			write.dstBinding = entry.dstBinding;
+			write.dstArrayElement = entry.dstArrayElement;
+			write.descriptorCount = entry.descriptorCount;
+			write.descriptorType = entry.descriptorType;
+			if (isBufferDescriptor(entry.descriptorType)) {
+				write.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo*>(infos);
+			} else if (isTexelBufferDescriptor(entry.descriptorType)) {
+				write.pTexelBufferView = reinterpret_cast<const VkBufferView*>(infos);
+			} else {
+				write.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo*>(infos);
+			}
+			writes.push_back(write);
+		}
+		vkUpdateDescriptorSets(veDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+
 	// ******************************	Descriptor Writer	*************************************** //
 	VeDescriptorWriter::VeDescriptorWriter(VeDescriptorSetLayout& setLayout, VeDescriptorPool& pool)
-		: setLayout{ setLayout }, pool{ pool } {}
+		: setLayout{ setLayout }, pool{ &pool } {}
+
+	VeDescriptorWriter::VeDescriptorWriter(VeDescriptorSetLayout& setLayout, VeDescriptorPoolManager& poolManager)
+		: setLayout{ setLayout }, poolManager{ &poolManager } {}
+
+	VeDescriptorWriter::VeDescriptorWriter(VeDescriptorSetLayout& setLayout, VeDescriptorSetCache& setCache)
+		: setLayout{ setLayout }, setCache{ &setCache } {}
 
 	VeDescriptorWriter& VeDescriptorWriter::writeBuffer(
 		uint32_t binding, VkDescriptorBufferInfo* bufferInfo) {
-		assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
-
-		auto& bindingDescription = setLayout.bindings[binding];
+		return writeBuffers(binding, bufferInfo, 1);
+	}
 
-		assert(
-			bindingDescription.descriptorCount == 1 &&
-			"Binding single descriptor info, but binding expects multiple");
+	VeDescriptorWriter& VeDescriptorWriter::writeImage(
+		uint32_t binding, VkDescriptorImageInfo* imageInfo) {
+		return writeImages(binding, imageInfo, 1);
+	}
 
-		VkWriteDescriptorSet write{};
-		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		write.descriptorType = bindingDescription.descriptorType;
-		write.dstBinding = binding;
-		write.pBufferInfo = bufferInfo;
-		write.descriptorCount = 1;
+	VeDescriptorWriter& VeDescriptorWriter::writeBuffers(
+		uint32_t binding, const VkDescriptorBufferInfo* bufferInfos, uint32_t count, uint32_t firstArrayElement) {
+		auto& write = addWrite(binding, count, firstArrayElement);
+		write.pBufferInfo = bufferInfos;
+		return *this;
+	}
 
-		writes.push_back(write);
+	VeDescriptorWriter& VeDescriptorWriter::writeImages(
+		uint32_t binding, const VkDescriptorImageInfo* imageInfos, uint32_t count, uint32_t firstArrayElement) {
+		auto& write = addWrite(binding, count, firstArrayElement);
+		write.pImageInfo = imageInfos;
 		return *this;
 	}
 
-	VeDescriptorWriter& VeDescriptorWriter::writeImage(
-		uint32_t binding, VkDescriptorImageInfo* imageInfo) {
+	VkWriteDescriptorSet& VeDescriptorWriter::addWrite(uint32_t binding, uint32_t count, uint32_t firstArrayElement) {
 		assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
 
 		auto& bindingDescription = setLayout.bindings[binding];
 
+		assert(count > 0 && "Writing zero descriptors");
 		assert(
-			bindingDescription.descriptorCount == 1 &&
-			"Binding single descriptor info, but binding expects multiple");
+			firstArrayElement + count <= bindingDescription.descriptorCount &&
+			"Writing past the end of the binding's descriptor array");
 
 		VkWriteDescriptorSet write{};
 		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		write.descriptorType = bindingDescription.descriptorType;
 		write.dstBinding = binding;
-		write.pImageInfo = imageInfo;
-		write.descriptorCount = 1;
+		write.dstArrayElement = firstArrayElement;
+		write.descriptorCount = count;
 
 		writes.push_back(write);
-		return *this;
+		return writes.back();
 	}
 
 	bool VeDescriptorWriter::build(VkDescriptorSet& set) {
-		bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
+		if (setCache != nullptr) {
+			return setCache->getDescriptorSet(setLayout.getDescriptorSetLayout(), writes, set);
+		}
+
+		bool success = pool != nullptr
+			? pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)
+			: poolManager->allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
 		if (!success) {
 			return false;
 		}
@@ -185,11 +545,33 @@ namespace ve {
 		return true;
 	}
 
+	std::unique_ptr<VeDescriptorUpdateTemplate> VeDescriptorWriter::buildUpdateTemplate() const {
+		std::vector<VkDescriptorUpdateTemplateEntry> entries{};
+		size_t offset = 0;
+		for (auto& write : writes) {
+			size_t stride = descriptorInfoSize(write.descriptorType);
+
+			VkDescriptorUpdateTemplateEntry entry{};
+			entry.dstBinding = write.dstBinding;
+			entry.dstArrayElement = write.dstArrayElement;
+			entry.descriptorCount = write.descriptorCount;
+			entry.descriptorType = write.descriptorType;
+			entry.offset = offset;
+			entry.stride = stride;
+			entries.push_back(entry);
+
+			offset += stride * write.descriptorCount;
+		}
+		return std::make_unique<VeDescriptorUpdateTemplate>(
+			setLayout.veDevice, setLayout.getDescriptorSetLayout(), entries, offset);
+	}
+
 	void VeDescriptorWriter::overwrite(VkDescriptorSet& set) {
+		assert(setCache == nullptr && "Cached descriptor sets are shared and must not be overwritten");
 		for (auto& write : writes) {
 			write.dstSet = set;
 		}
-		vkUpdateDescriptorSets(pool.veDevice.device(), writes.size(), writes.data(), 0, nullptr);
+		vkUpdateDescriptorSets(setLayout.veDevice.device(), writes.size(), writes.data(), 0, nullptr);
 	}
 
 } // namespace ve
\ No newline at end of file
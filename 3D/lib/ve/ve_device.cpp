@@ -1,7 +1,13 @@
 #include "ve/ve_device.hpp"
+#include "ve/ve_shader_cache.hpp"
 
 // std headers
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -55,9 +61,14 @@ namespace ve {
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        createPipelineCache();
+        shaderCache_ = std::make_unique<VeShaderCache>(*this);
     }
 
     VeDevice::~VeDevice() {
+        shaderCache_.reset();
+        savePipelineCache();
+        vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
         vkDestroyCommandPool(device_, commandPool, nullptr);
         vkDestroyDevice(device_, nullptr);
 
@@ -80,7 +91,16 @@ namespace ve {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // vkEnumerateInstanceVersion only exists on 1.1+ loaders, a 1.0 loader rejects higher versions
+        auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+            nullptr,
+            "vkEnumerateInstanceVersion");
+        uint32_t instanceVersion = VK_API_VERSION_1_0;
+        if (enumerateInstanceVersion != nullptr) {
+            enumerateInstanceVersion(&instanceVersion);
+        }
+        apiVersion_ = std::min(instanceVersion, TARGET_API_VERSION);
+        appInfo.apiVersion = apiVersion_;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -133,6 +153,98 @@ namespace ve {
 
         vkGetPhysicalDeviceProperties(physicalDevice, &properties);
         std::cout << "physical device: " << properties.deviceName << std::endl;
+
+        apiVersion_ = std::min(apiVersion_, properties.apiVersion);
+        queryOptionalFeatures();
+    }
+
+    void VeDevice::queryOptionalFeatures() {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+        enabledDeviceExtensions_ = deviceExtensions;
+        for (const char* optional : optionalDeviceExtensions) {
+            for (const auto& extension : availableExtensions) {
+                if (strcmp(optional, extension.extensionName) == 0) {
+                    enabledDeviceExtensions_.push_back(optional);
+                    break;
+                }
+            }
+        }
+
+        // indirect draws of many objects in one call, each addressing its per object data by firstInstance
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        multiDrawIndirectSupported_ = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+
+        // the extension depends on depth_stencil_resolve and create_renderpass2, both core in 1.2
+        if (apiVersion_ >= VK_API_VERSION_1_2 && isExtensionEnabled(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+            VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+            dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+            VkPhysicalDeviceFeatures2 features2{};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &dynamicRenderingFeatures;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+            dynamicRenderingSupported_ = dynamicRenderingFeatures.dynamicRendering;
+        }
+        if (!dynamicRenderingSupported_) {
+            enabledDeviceExtensions_.erase(
+                std::remove_if(
+                    enabledDeviceExtensions_.begin(),
+                    enabledDeviceExtensions_.end(),
+                    [](const char* extension) { return strcmp(extension, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0; }),
+                enabledDeviceExtensions_.end());
+        }
+
+        // descriptor indexing is core in 1.2, before that it needs the extension and features2 from 1.1
+        bool hasDescriptorIndexing = apiVersion_ >= VK_API_VERSION_1_2 ||
+            isExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        if (apiVersion_ < VK_API_VERSION_1_1 || !hasDescriptorIndexing) {
+            return;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+        bindlessSupported_ = indexingFeatures.runtimeDescriptorArray &&
+            indexingFeatures.descriptorBindingPartiallyBound &&
+            indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+            indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+            indexingFeatures.shaderStorageBufferArrayNonUniformIndexing;
+
+        // only enable what the bindless path uses
+        descriptorIndexingFeatures_ = {};
+        descriptorIndexingFeatures_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        descriptorIndexingFeatures_.runtimeDescriptorArray = bindlessSupported_;
+        descriptorIndexingFeatures_.descriptorBindingPartiallyBound = bindlessSupported_;
+        descriptorIndexingFeatures_.descriptorBindingUpdateUnusedWhilePending = bindlessSupported_;
+        descriptorIndexingFeatures_.descriptorBindingSampledImageUpdateAfterBind = bindlessSupported_;
+        descriptorIndexingFeatures_.descriptorBindingStorageBufferUpdateAfterBind = bindlessSupported_;
+        descriptorIndexingFeatures_.shaderSampledImageArrayNonUniformIndexing = bindlessSupported_;
+        descriptorIndexingFeatures_.shaderStorageBufferArrayNonUniformIndexing = bindlessSupported_;
+    }
+
+    bool VeDevice::isExtensionEnabled(const char* extensionName) const {
+        for (const char* extension : enabledDeviceExtensions_) {
+            if (strcmp(extension, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
     }
 
     void VeDevice::createLogicalDevice() {
@@ -153,6 +265,8 @@ namespace ve {
 
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.multiDrawIndirect = multiDrawIndirectSupported_ ? VK_TRUE : VK_FALSE;
+        deviceFeatures.drawIndirectFirstInstance = multiDrawIndirectSupported_ ? VK_TRUE : VK_FALSE;
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -160,9 +274,33 @@ namespace ve {
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-        createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        // optional features go through the features2 chain, which replaces pEnabledFeatures
+        void* featureChain = nullptr;
+        if (bindlessSupported_) {
+            descriptorIndexingFeatures_.pNext = featureChain;
+            featureChain = &descriptorIndexingFeatures_;
+        }
+        VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+        if (dynamicRenderingSupported_) {
+            dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+            dynamicRenderingFeatures.pNext = featureChain;
+            featureChain = &dynamicRenderingFeatures;
+        }
+
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.features = deviceFeatures;
+        if (featureChain != nullptr) {
+            features2.pNext = featureChain;
+            createInfo.pNext = &features2;
+        }
+        else {
+            createInfo.pEnabledFeatures = &deviceFeatures;
+        }
+
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions_.size());
+        createInfo.ppEnabledExtensionNames = enabledDeviceExtensions_.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -180,6 +318,15 @@ namespace ve {
 
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+        // the core entry points only exist from 1.3 on, so go through the extension's
+        if (dynamicRenderingSupported_) {
+            cmdBeginRendering_ = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(device_, "vkCmdBeginRenderingKHR");
+            cmdEndRendering_ = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(device_, "vkCmdEndRenderingKHR");
+            if (cmdBeginRendering_ == nullptr || cmdEndRendering_ == nullptr) {
+                throw std::runtime_error("failed to load dynamic rendering functions!");
+            }
+        }
     }
 
     void VeDevice::createCommandPool() {
@@ -196,6 +343,91 @@ namespace ve {
         }
     }
 
+    void VeDevice::createPipelineCache() {
+        std::vector<char> cacheData{};
+
+        std::ifstream file{ PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary };
+        if (file.is_open()) {
+            cacheData.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(cacheData.data(), cacheData.size());
+            file.close();
+        }
+
+        // a cache written by a different driver or GPU is rejected (or worse) by some implementations,
+        // so only hand the blob to vulkan when its header matches this physical device
+        if (!cacheData.empty() && !isPipelineCacheCompatible(cacheData)) {
+            std::cout << "discarding incompatible pipeline cache: " << PIPELINE_CACHE_PATH << std::endl;
+            cacheData.clear();
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = cacheData.size();
+        createInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+        if (vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    void VeDevice::savePipelineCache() {
+        size_t dataSize = 0;
+        if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+            return;
+        }
+
+        std::vector<char> cacheData(dataSize);
+        if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, cacheData.data()) != VK_SUCCESS) {
+            return;
+        }
+
+        // write next to the old cache and swap it in, so a crash mid-write never leaves a truncated cache
+        const std::string tempPath = std::string{ PIPELINE_CACHE_PATH } + ".tmp";
+        std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+        if (!file.is_open()) {
+            std::cerr << "failed to write pipeline cache: " << tempPath << std::endl;
+            return;
+        }
+        // a short write (e.g. a full disk) must not replace a good cache with a truncated one
+        file.write(cacheData.data(), dataSize);
+        bool written = file.good();
+        file.close();
+        if (!written || !file.good()) {
+            std::cerr << "failed to write pipeline cache: " << tempPath << std::endl;
+            std::remove(tempPath.c_str());
+            return;
+        }
+
+        // rename replaces the old cache atomically on POSIX; Windows refuses to overwrite an existing file
+        // (EEXIST, or EACCES with the MSVC runtime), so only there the old cache is removed and the rename retried
+        int result = std::rename(tempPath.c_str(), PIPELINE_CACHE_PATH);
+#ifdef _WIN32
+        if (result != 0 && (errno == EEXIST || errno == EACCES)) {
+            std::remove(PIPELINE_CACHE_PATH);
+            result = std::rename(tempPath.c_str(), PIPELINE_CACHE_PATH);
+        }
+#endif
+        if (result != 0) {
+            std::cerr << "failed to write pipeline cache: " << PIPELINE_CACHE_PATH << std::endl;
+            std::remove(tempPath.c_str());
+        }
+    }
+
+    bool VeDevice::isPipelineCacheCompatible(const std::vector<char>& cacheData) {
+        VkPipelineCacheHeaderVersionOne header{};
+        if (cacheData.size() < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, cacheData.data(), sizeof(header));
+
+        return header.headerSize >= sizeof(header) &&
+            header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            header.vendorID == properties.vendorID &&
+            header.deviceID == properties.deviceID &&
+            memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
     void VeDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
     bool VeDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -394,6 +626,34 @@ namespace ve {
         throw std::runtime_error("failed to find supported format!");
     }
 
+    uint32_t VeDevice::getTimestampValidBits() {
+        QueueFamilyIndices indices = findPhysicalQueueFamilies();
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        return queueFamilies[indices.graphicsFamily].timestampValidBits;
+    }
+
+    VkSampleCountFlagBits VeDevice::getMaxUsableSampleCount() const {
+        VkSampleCountFlags counts =
+            properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+        for (VkSampleCountFlagBits samples : {
+                 VK_SAMPLE_COUNT_64_BIT,
+                 VK_SAMPLE_COUNT_32_BIT,
+                 VK_SAMPLE_COUNT_16_BIT,
+                 VK_SAMPLE_COUNT_8_BIT,
+                 VK_SAMPLE_COUNT_4_BIT,
+                 VK_SAMPLE_COUNT_2_BIT }) {
+            if (counts & samples) {
+                return samples;
+            }
+        }
+        return VK_SAMPLE_COUNT_1_BIT;
+    }
+
     uint32_t VeDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
         VkPhysicalDeviceMemoryProperties memProperties;
         vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -535,4 +795,45 @@ namespace ve {
         }
     }
 
+    void VeDevice::createTransientAttachment(
+        const VkImageCreateInfo& imageInfo,
+        VkImage& image,
+        VkDeviceMemory& imageMemory) {
+        assert((imageInfo.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) && "image is not a transient attachment");
+
+        if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device_, image, &memRequirements);
+
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        uint32_t memoryTypeIndex = UINT32_MAX;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((memRequirements.memoryTypeBits & (1 << i)) &&
+                (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+                memoryTypeIndex = i;
+                break;
+            }
+        }
+        if (memoryTypeIndex == UINT32_MAX) {
+            memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+
+        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind image memory!");
+        }
+    }
+
 }  // namespace lve
\ No newline at end of file
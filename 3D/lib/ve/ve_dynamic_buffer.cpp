@@ -0,0 +1,88 @@
+#include "ve/ve_dynamic_buffer.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace ve {
+
+	VeDynamicBuffer::VeDynamicBuffer(
+		VeDevice& device,
+		VkDeviceSize objectSize,
+		uint32_t maxObjectsPerFrame,
+		VkDescriptorType descriptorType)
+		: descriptorType{ descriptorType }, maxObjectsPerFrame{ maxObjectsPerFrame } {
+		assert(
+			(descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+				descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) &&
+			"Dynamic buffer needs a dynamic descriptor type");
+
+		if (descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC &&
+			objectSize > device.properties.limits.maxUniformBufferRange) {
+			throw std::runtime_error("dynamic uniform buffer object exceeds maxUniformBufferRange!");
+		}
+
+		VkBufferUsageFlags usage = descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+			? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+			: VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+		// host coherent and persistently mapped, the frame's region is rewritten every frame
+		buffer = std::make_unique<VeBuffer>(
+			device,
+			objectSize,
+			maxObjectsPerFrame * VeSwapChain::MAX_FRAMES_IN_FLIGHT,
+			usage,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			minOffsetAlignment(device, descriptorType));
+		if (buffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map dynamic buffer!");
+		}
+	}
+
+	VkDeviceSize VeDynamicBuffer::minOffsetAlignment(VeDevice& device, VkDescriptorType descriptorType) {
+		return descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+			? device.properties.limits.minUniformBufferOffsetAlignment
+			: device.properties.limits.minStorageBufferOffsetAlignment;
+	}
+
+	void VeDynamicBuffer::beginFrame(int frameIndex) {
+		assert(frameIndex >= 0 && frameIndex < VeSwapChain::MAX_FRAMES_IN_FLIGHT && "Frame index out of range");
+		frameBase = static_cast<uint32_t>(frameIndex) * maxObjectsPerFrame;
+		objectCount = 0;
+	}
+
+	uint32_t VeDynamicBuffer::push(const void* data) {
+		if (objectCount >= maxObjectsPerFrame) {
+			throw std::runtime_error("dynamic buffer frame region is full!");
+		}
+		memcpy(getObjectMemory(objectCount), data, buffer->getInstanceSize());
+		return objectCount++;
+	}
+
+	void VeDynamicBuffer::writeObjects(const void* data, uint32_t count, uint32_t firstObject) {
+		if (firstObject + count > maxObjectsPerFrame) {
+			throw std::runtime_error("dynamic buffer frame region is full!");
+		}
+		memcpy(getObjectMemory(firstObject), data, count * getAlignmentSize());
+		objectCount = std::max(objectCount, firstObject + count);
+	}
+
+	void* VeDynamicBuffer::getObjectMemory(uint32_t objectIndex) const {
+		assert(objectIndex < maxObjectsPerFrame && "Object index out of range");
+		return static_cast<char*>(buffer->getMappedMemory()) + (frameBase + objectIndex) * getAlignmentSize();
+	}
+
+	uint32_t VeDynamicBuffer::getDynamicOffset(uint32_t objectIndex) const {
+		assert(objectIndex < maxObjectsPerFrame && "Object index out of range");
+		return static_cast<uint32_t>((frameBase + objectIndex) * getAlignmentSize());
+	}
+
+	VkDescriptorBufferInfo VeDynamicBuffer::descriptorInfo() const {
+		return VkDescriptorBufferInfo{ buffer->getBuffer(), 0, buffer->getInstanceSize() };
+	}
+
+} // namespace ve
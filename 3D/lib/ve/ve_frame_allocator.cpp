@@ -0,0 +1,57 @@
+#include "ve/ve_frame_allocator.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+
+namespace ve {
+
+	VeFrameAllocator::VeFrameAllocator(VeDevice& device, VkDeviceSize bytesPerFrame, VkBufferUsageFlags usageFlags) {
+		const auto& limits = device.properties.limits;
+		defaultAlignment = std::max<VkDeviceSize>(
+			{ 16, limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment });
+
+		// keep every frame region starting on an aligned offset
+		this->bytesPerFrame = (bytesPerFrame + defaultAlignment - 1) & ~(defaultAlignment - 1);
+
+		buffer = std::make_unique<VeBuffer>(
+			device,
+			this->bytesPerFrame,
+			VeSwapChain::MAX_FRAMES_IN_FLIGHT,
+			usageFlags,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (buffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map frame allocator buffer!");
+		}
+	}
+
+	void VeFrameAllocator::beginFrame(int frameIndex) {
+		assert(frameIndex >= 0 && frameIndex < VeSwapChain::MAX_FRAMES_IN_FLIGHT && "Frame index out of range");
+		frameBase = static_cast<VkDeviceSize>(frameIndex) * bytesPerFrame;
+		head = frameBase;
+	}
+
+	VeFrameAllocator::Allocation VeFrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+		if (alignment == 0) {
+			alignment = defaultAlignment;
+		}
+		assert((alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+		VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+		if (offset + size > frameBase + bytesPerFrame) {
+			throw std::runtime_error("frame allocator is out of memory!");
+		}
+		head = offset + size;
+
+		Allocation allocation{};
+		allocation.buffer = buffer->getBuffer();
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.mapped = static_cast<char*>(buffer->getMappedMemory()) + offset;
+		return allocation;
+	}
+
+} // namespace ve
@@ -0,0 +1,222 @@
+#include "ve/ve_gpu_profiler.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+
+namespace ve {
+
+	VeGpuProfiler::VeGpuProfiler(VeDevice& device, uint32_t maxScopesPerFrame, uint32_t averageWindow)
+		: veDevice{ device }, maxScopesPerFrame{ maxScopesPerFrame }, averageWindow{ std::max(averageWindow, 1u) } {
+		frames.resize(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		uint32_t validBits = veDevice.getTimestampValidBits();
+		supported = validBits > 0;
+		if (!supported) {
+			return;
+		}
+		timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		timestampPeriod = veDevice.properties.limits.timestampPeriod;
+
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = maxScopesPerFrame * 2;
+
+		for (auto& frame : frames) {
+			if (vkCreateQueryPool(veDevice.device(), &queryPoolInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create timestamp query pool!");
+			}
+		}
+	}
+
+	VeGpuProfiler::~VeGpuProfiler() {
+		for (auto& frame : frames) {
+			if (frame.queryPool != VK_NULL_HANDLE) {
+				vkDestroyQueryPool(veDevice.device(), frame.queryPool, nullptr);
+			}
+		}
+	}
+
+	void VeGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, int frameIndex) {
+		assert(frameIndex >= 0 && frameIndex < VeSwapChain::MAX_FRAMES_IN_FLIGHT && "Frame index out of range");
+		assert(openScopes.empty() && "Scope left open in the previous frame");
+		currentFrameIndex = frameIndex;
+		if (!supported) {
+			return;
+		}
+
+		FrameQueries& frame = frames[frameIndex];
+		collectResults(frame);
+		frame.scopes.clear();
+		vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, maxScopesPerFrame * 2);
+	}
+
+	void VeGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name, VkPipelineStageFlagBits stage) {
+		assert(currentFrameIndex >= 0 && "Cannot begin a GPU scope before beginFrame");
+		if (!supported) {
+			return;
+		}
+
+		FrameQueries& frame = frames[currentFrameIndex];
+		if (frame.scopes.size() >= maxScopesPerFrame) {
+			// out of queries, the scope goes unmeasured but endScope stays balanced
+			assert(false && "Too many GPU scopes in one frame, raise maxScopesPerFrame");
+			openScopes.push_back(UINT32_MAX);
+			return;
+		}
+
+		auto it = statsIndices.find(name);
+		if (it == statsIndices.end()) {
+			ScopeStats scopeStats{};
+			scopeStats.name = name;
+			scopeStats.depth = static_cast<uint32_t>(openScopes.size());
+			it = statsIndices.emplace(name, static_cast<uint32_t>(stats.size())).first;
+			stats.push_back(scopeStats);
+			histories.push_back({});
+		}
+
+		uint32_t scopeIndex = static_cast<uint32_t>(frame.scopes.size());
+		frame.scopes.push_back({ it->second });
+		openScopes.push_back(scopeIndex);
+		vkCmdWriteTimestamp(commandBuffer, stage, frame.queryPool, scopeIndex * 2);
+	}
+
+	void VeGpuProfiler::endScope(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage) {
+		if (!supported) {
+			return;
+		}
+		assert(!openScopes.empty() && "No GPU scope to end");
+
+		uint32_t scopeIndex = openScopes.back();
+		openScopes.pop_back();
+		if (scopeIndex == UINT32_MAX) {
+			return;
+		}
+
+		FrameQueries& frame = frames[currentFrameIndex];
+		frame.scopes[scopeIndex].ended = true;
+		vkCmdWriteTimestamp(commandBuffer, stage, frame.queryPool, scopeIndex * 2 + 1);
+	}
+
+	void VeGpuProfiler::collectResults(FrameQueries& frame) {
+		if (frame.scopes.empty()) {
+			return;
+		}
+
+		// the frame's fence has signalled, so this only returns VK_NOT_READY if a scope was never submitted
+		uint32_t queryCount = static_cast<uint32_t>(frame.scopes.size()) * 2;
+		std::vector<uint64_t> timestamps(queryCount);
+		VkResult result = vkGetQueryPoolResults(
+			veDevice.device(),
+			frame.queryPool,
+			0,
+			queryCount,
+			timestamps.size() * sizeof(uint64_t),
+			timestamps.data(),
+			sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS) {
+			return;
+		}
+
+		// a name used several times in a frame counts once with the summed time
+		std::vector<float> frameTotals(stats.size(), 0.f);
+		std::vector<bool> ran(stats.size(), false);
+		for (size_t i = 0; i < frame.scopes.size(); i++) {
+			const RecordedScope& scope = frame.scopes[i];
+			if (!scope.ended) {
+				continue;
+			}
+			uint64_t begin = timestamps[i * 2] & timestampMask;
+			uint64_t end = timestamps[i * 2 + 1] & timestampMask;
+			uint64_t ticks = (end - begin) & timestampMask;
+			frameTotals[scope.statsIndex] += static_cast<float>(static_cast<double>(ticks) * timestampPeriod / 1e6);
+			ran[scope.statsIndex] = true;
+		}
+
+		for (uint32_t i = 0; i < stats.size(); i++) {
+			if (ran[i]) {
+				addSample(i, frameTotals[i]);
+			}
+		}
+	}
+
+	void VeGpuProfiler::addSample(uint32_t statsIndex, float ms) {
+		History& history = histories[statsIndex];
+		ScopeStats& scopeStats = stats[statsIndex];
+
+		if (history.samples.size() < averageWindow) {
+			history.samples.push_back(ms);
+		}
+		else {
+			history.sum -= history.samples[history.next];
+			history.samples[history.next] = ms;
+		}
+		history.next = (history.next + 1) % averageWindow;
+		history.sum += ms;
+
+		scopeStats.lastMs = ms;
+		scopeStats.averageMs = history.sum / static_cast<float>(history.samples.size());
+		auto [minIt, maxIt] = std::minmax_element(history.samples.begin(), history.samples.end());
+		scopeStats.minMs = *minIt;
+		scopeStats.maxMs = *maxIt;
+	}
+
+	const VeGpuProfiler::ScopeStats* VeGpuProfiler::findScope(const std::string& name) const {
+		auto it = statsIndices.find(name);
+		if (it == statsIndices.end() || histories[it->second].samples.empty()) {
+			return nullptr;
+		}
+		return &stats[it->second];
+	}
+
+	float VeGpuProfiler::getLastMs(const std::string& name) const {
+		const ScopeStats* scopeStats = findScope(name);
+		return scopeStats != nullptr ? scopeStats->lastMs : 0.f;
+	}
+
+	float VeGpuProfiler::getAverageMs(const std::string& name) const {
+		const ScopeStats* scopeStats = findScope(name);
+		return scopeStats != nullptr ? scopeStats->averageMs : 0.f;
+	}
+
+	void VeGpuProfiler::printStats(std::ostream& out) const {
+		out << "GPU scopes (ms, average of last " << averageWindow << " frames):" << std::endl;
+		for (size_t i = 0; i < stats.size(); i++) {
+			if (histories[i].samples.empty()) {
+				continue;
+			}
+			const ScopeStats& scopeStats = stats[i];
+			out << std::string(2 + scopeStats.depth * 2, ' ') << scopeStats.name << ": "
+				<< std::fixed << std::setprecision(3) << scopeStats.averageMs
+				<< " (last " << scopeStats.lastMs
+				<< ", min " << scopeStats.minMs
+				<< ", max " << scopeStats.maxMs << ")" << std::endl;
+		}
+	}
+
+	void VeGpuProfiler::writeCsv(const std::string& filepath) const {
+		std::ofstream file{ filepath, std::ios::trunc };
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		file << "scope,depth,last_ms,average_ms,min_ms,max_ms\n";
+		for (size_t i = 0; i < stats.size(); i++) {
+			if (histories[i].samples.empty()) {
+				continue;
+			}
+			const ScopeStats& scopeStats = stats[i];
+			file << '"' << scopeStats.name << "\"," << scopeStats.depth << ','
+				<< scopeStats.lastMs << ',' << scopeStats.averageMs << ','
+				<< scopeStats.minMs << ',' << scopeStats.maxMs << '\n';
+		}
+	}
+
+} // namespace ve
@@ -0,0 +1,492 @@
+#include "ve/ve_hiz_culling.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace ve {
+
+	namespace {
+		constexpr uint32_t WORKGROUP_SIZE_1D = 64;
+		constexpr uint32_t WORKGROUP_SIZE_2D = 8;
+		constexpr uint32_t MAX_PYRAMID_MIPS = 16;
+
+		struct DownsamplePush {
+			glm::uvec2 outputSize;
+		};
+
+		struct CullPush {
+			uint32_t phase;
+			uint32_t commandOffset;
+			glm::vec2 pyramidSize;
+		};
+
+		uint32_t previousPowerOfTwo(uint32_t value) {
+			uint32_t result = 1;
+			while (result * 2 <= value) {
+				result *= 2;
+			}
+			return result;
+		}
+	} // namespace
+
+	VeHiZCulling::VeHiZCulling(
+		VeDevice& device,
+		uint32_t maxObjects,
+		const std::string& downsampleShaderFilepath,
+		const std::string& cullShaderFilepath)
+		: veDevice{ device }, maxObjects{ std::max(maxObjects, 1u) } {
+		if (!veDevice.supportsMultiDrawIndirect()) {
+			throw std::runtime_error("failed to create Hi-Z culling, multi draw indirect is not supported!");
+		}
+
+		createSampler();
+		createDescriptorLayouts();
+		createPipelines(downsampleShaderFilepath, cullShaderFilepath);
+		createBuffers();
+		// a 1x1 pyramid keeps the cull descriptors valid until the first buildPyramid()
+		createPyramid({ 1, 1 });
+	}
+
+	VeHiZCulling::~VeHiZCulling() {
+		destroyPyramid();
+		vkDestroyPipeline(veDevice.device(), cullPipeline, nullptr);
+		vkDestroyPipeline(veDevice.device(), downsamplePipeline, nullptr);
+		vkDestroyPipelineLayout(veDevice.device(), cullPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(veDevice.device(), downsamplePipelineLayout, nullptr);
+		vkDestroySampler(veDevice.device(), sampler, nullptr);
+	}
+
+	void VeHiZCulling::createSampler() {
+		// only read with texelFetch, the reduction is done by hand in the shaders
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.minLod = 0.f;
+		samplerInfo.maxLod = static_cast<float>(MAX_PYRAMID_MIPS);
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+		if (vkCreateSampler(veDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create Hi-Z sampler!");
+		}
+	}
+
+	void VeHiZCulling::createDescriptorLayouts() {
+		downsampleSetLayout = VeDescriptorSetLayout::Builder(veDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+
+		cullSetLayout = VeDescriptorSetLayout::Builder(veDevice)
+			.addBinding(CULL_DATA_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(OBJECTS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(VISIBILITY_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(DRAW_COMMANDS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(DEPTH_PYRAMID_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+
+		// per frame: one cull set and the set reducing the frame's depth into mip 0
+		cullDescriptorPool = VeDescriptorPool::Builder(veDevice)
+			.setMaxSets(2 * VeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * VeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * VeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VeSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+
+		// reset whenever the pyramid is recreated
+		pyramidDescriptorPool = VeDescriptorPool::Builder(veDevice)
+			.setMaxSets(MAX_PYRAMID_MIPS)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_PYRAMID_MIPS)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_PYRAMID_MIPS)
+			.build();
+	}
+
+	void VeHiZCulling::createPipelines(const std::string& downsampleShaderFilepath, const std::string& cullShaderFilepath) {
+		downsampleShader = veDevice.shaderCache().getShaderModule(downsampleShaderFilepath);
+		cullShader = veDevice.shaderCache().getShaderModule(cullShaderFilepath);
+
+		auto createLayout = [&](VeDescriptorSetLayout& setLayout, uint32_t pushSize, VkPipelineLayout& pipelineLayout) {
+			VkDescriptorSetLayout descriptorSetLayout = setLayout.getDescriptorSetLayout();
+			VkPushConstantRange pushConstantRange{};
+			pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			pushConstantRange.offset = 0;
+			pushConstantRange.size = pushSize;
+
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipelineLayoutInfo.setLayoutCount = 1;
+			pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+			if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create Hi-Z pipeline layout!");
+			}
+		};
+		createLayout(*downsampleSetLayout, sizeof(DownsamplePush), downsamplePipelineLayout);
+		createLayout(*cullSetLayout, sizeof(CullPush), cullPipelineLayout);
+
+		auto createPipeline = [&](const VeShaderModule& shader, VkPipelineLayout pipelineLayout, VkPipeline& pipeline) {
+			VkComputePipelineCreateInfo pipelineInfo{};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = shader.getShaderModule();
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = pipelineLayout;
+			if (vkCreateComputePipelines(veDevice.device(), veDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create Hi-Z compute pipeline!");
+			}
+		};
+		createPipeline(*downsampleShader, downsamplePipelineLayout, downsamplePipeline);
+		createPipeline(*cullShader, cullPipelineLayout, cullPipeline);
+	}
+
+	void VeHiZCulling::createBuffers() {
+		visibilityBuffer = std::make_unique<VeBuffer>(
+			veDevice,
+			sizeof(uint32_t),
+			maxObjects,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		drawCommandBuffer = std::make_unique<VeBuffer>(
+			veDevice,
+			sizeof(VkDrawIndexedIndirectCommand),
+			2 * maxObjects,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		frames.resize(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+		for (auto& frame : frames) {
+			frame.cullDataBuffer = std::make_unique<VeBuffer>(
+				veDevice,
+				sizeof(HiZCullData),
+				1,
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			frame.objectBuffer = std::make_unique<VeBuffer>(
+				veDevice,
+				sizeof(HiZCullObject),
+				maxObjects,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			if (frame.cullDataBuffer->map() != VK_SUCCESS || frame.objectBuffer->map() != VK_SUCCESS) {
+				throw std::runtime_error("failed to map Hi-Z culling buffer!");
+			}
+
+			// the pyramid binding is written by createPyramid()
+			auto cullDataInfo = frame.cullDataBuffer->descriptorInfo();
+			auto objectInfo = frame.objectBuffer->descriptorInfo();
+			auto visibilityInfo = visibilityBuffer->descriptorInfo();
+			auto drawCommandInfo = drawCommandBuffer->descriptorInfo();
+			if (!cullDescriptorPool->allocateDescriptor(cullSetLayout->getDescriptorSetLayout(), frame.cullSet) ||
+				!cullDescriptorPool->allocateDescriptor(downsampleSetLayout->getDescriptorSetLayout(), frame.depthDownsampleSet)) {
+				throw std::runtime_error("failed to allocate Hi-Z descriptor set!");
+			}
+			VeDescriptorWriter(*cullSetLayout, *cullDescriptorPool)
+				.writeBuffer(CULL_DATA_BINDING, &cullDataInfo)
+				.writeBuffer(OBJECTS_BINDING, &objectInfo)
+				.writeBuffer(VISIBILITY_BINDING, &visibilityInfo)
+				.writeBuffer(DRAW_COMMANDS_BINDING, &drawCommandInfo)
+				.overwrite(frame.cullSet);
+		}
+	}
+
+	void VeHiZCulling::createPyramid(VkExtent2D extent) {
+		// a power of two pyramid halves exactly from mip 0 on, mip 0 itself covers up to 3x3 depth texels
+		pyramidExtent = { previousPowerOfTwo(extent.width), previousPowerOfTwo(extent.height) };
+		pyramidMipCount = 1;
+		while ((std::max(pyramidExtent.width, pyramidExtent.height) >> pyramidMipCount) > 0) {
+			pyramidMipCount++;
+		}
+		assert(pyramidMipCount <= MAX_PYRAMID_MIPS && "Hi-Z pyramid has too many mips");
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = pyramidExtent.width;
+		imageInfo.extent.height = pyramidExtent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = pyramidMipCount;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		veDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pyramidImage, pyramidMemory);
+
+		auto createView = [&](uint32_t baseMip, uint32_t mipCount, VkImageView& view) {
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = pyramidImage;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = VK_FORMAT_R32_SFLOAT;
+			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			viewInfo.subresourceRange.baseMipLevel = baseMip;
+			viewInfo.subresourceRange.levelCount = mipCount;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+			if (vkCreateImageView(veDevice.device(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create Hi-Z pyramid image view!");
+			}
+		};
+		createView(0, pyramidMipCount, pyramidView);
+		pyramidMipViews.resize(pyramidMipCount);
+		for (uint32_t mip = 0; mip < pyramidMipCount; mip++) {
+			createView(mip, 1, pyramidMipViews[mip]);
+		}
+
+		// the pyramid lives in GENERAL, cleared to the far plane so nothing is culled before the first build
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = pyramidImage;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidMipCount, 0, 1 };
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		VkClearColorValue farPlane{};
+		farPlane.float32[0] = 1.f;
+
+		VkCommandBuffer commandBuffer = veDevice.beginSingleTimeCommands();
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+		vkCmdClearColorImage(commandBuffer, pyramidImage, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &barrier.subresourceRange);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+		veDevice.endSingleTimeCommands(commandBuffer);
+
+		pyramidMipSets.assign(pyramidMipCount, VK_NULL_HANDLE);
+		for (uint32_t mip = 1; mip < pyramidMipCount; mip++) {
+			VkDescriptorImageInfo inputInfo{ sampler, pyramidMipViews[mip - 1], VK_IMAGE_LAYOUT_GENERAL };
+			VkDescriptorImageInfo outputInfo{ VK_NULL_HANDLE, pyramidMipViews[mip], VK_IMAGE_LAYOUT_GENERAL };
+			if (!VeDescriptorWriter(*downsampleSetLayout, *pyramidDescriptorPool)
+				.writeImage(0, &inputInfo)
+				.writeImage(1, &outputInfo)
+				.build(pyramidMipSets[mip])) {
+				throw std::runtime_error("failed to allocate Hi-Z pyramid descriptor set!");
+			}
+		}
+
+		auto pyramidInfo = pyramidDescriptorInfo();
+		for (auto& frame : frames) {
+			VeDescriptorWriter(*cullSetLayout, *cullDescriptorPool)
+				.writeImage(DEPTH_PYRAMID_BINDING, &pyramidInfo)
+				.overwrite(frame.cullSet);
+		}
+	}
+
+	void VeHiZCulling::destroyPyramid() {
+		pyramidDescriptorPool->resetPool();
+		pyramidMipSets.clear();
+		for (auto view : pyramidMipViews) {
+			vkDestroyImageView(veDevice.device(), view, nullptr);
+		}
+		pyramidMipViews.clear();
+		vkDestroyImageView(veDevice.device(), pyramidView, nullptr);
+		vkDestroyImage(veDevice.device(), pyramidImage, nullptr);
+		vkFreeMemory(veDevice.device(), pyramidMemory, nullptr);
+		pyramidView = VK_NULL_HANDLE;
+		pyramidImage = VK_NULL_HANDLE;
+		pyramidMemory = VK_NULL_HANDLE;
+	}
+
+	void VeHiZCulling::setObjects(int frameIndex, const std::vector<HiZCullObject>& objects) {
+		assert(objects.size() <= maxObjects && "Too many objects for Hi-Z culling");
+		auto& frame = frames[frameIndex];
+		frame.objectCount = static_cast<uint32_t>(std::min<size_t>(objects.size(), maxObjects));
+		memcpy(frame.objectBuffer->getMappedMemory(), objects.data(), frame.objectCount * sizeof(HiZCullObject));
+	}
+
+	void VeHiZCulling::resize(VkExtent2D extent) {
+		VkExtent2D wantedExtent{ previousPowerOfTwo(extent.width), previousPowerOfTwo(extent.height) };
+		if (wantedExtent.width == pyramidExtent.width && wantedExtent.height == pyramidExtent.height) {
+			return;
+		}
+
+		// swap chain resizes are rare, waiting keeps the pyramid and its descriptors out of use
+		vkDeviceWaitIdle(veDevice.device());
+		destroyPyramid();
+		createPyramid(extent);
+	}
+
+	void VeHiZCulling::cullFirstPhase(VkCommandBuffer commandBuffer, int frameIndex, const VeCamera& camera, VkExtent2D extent) {
+		// before anything reading the pyramid or the cull sets is recorded, as recreating rewrites them
+		resize(extent);
+
+		const glm::mat4& projection = camera.getProjection();
+		assert(projection[2][3] == 1.f && "Hi-Z culling needs a perspective projection");
+
+		HiZCullData cullData{};
+		cullData.view = camera.getView();
+		cullData.projection = glm::vec4(projection[0][0], projection[1][1], projection[2][2], projection[3][2]);
+
+		// |x| <= z / P00 and |y| <= z / P11 at the frustum's sides, as planes normalized for sphere tests
+		float invP00 = 1.f / std::abs(projection[0][0]);
+		float invP11 = 1.f / std::abs(projection[1][1]);
+		float lengthX = std::sqrt(1.f + invP00 * invP00);
+		float lengthY = std::sqrt(1.f + invP11 * invP11);
+		cullData.frustum = glm::vec4(1.f / lengthX, invP00 / lengthX, 1.f / lengthY, invP11 / lengthY);
+
+		// near and far planes recovered from VeCamera::setPerspectiveProjection's matrix
+		cullData.depthRange = glm::vec4(
+			-projection[3][2] / projection[2][2],
+			projection[3][2] / (1.f - projection[2][2]),
+			0.f,
+			0.f);
+		cullData.objectCount = glm::uvec4(frames[frameIndex].objectCount, 0, 0, 0);
+		frames[frameIndex].cullDataBuffer->writeToBuffer(&cullData);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		if (visibilityResetPending) {
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+			vkCmdFillBuffer(commandBuffer, visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+			visibilityResetPending = false;
+		}
+
+		// last frame's draws are done reading the commands and its second phase wrote visibility
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		dispatchCull(commandBuffer, frameIndex, 0);
+	}
+
+	void VeHiZCulling::buildPyramid(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView) {
+		auto& frame = frames[frameIndex];
+		VkDescriptorImageInfo depthInfo{ sampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		VkDescriptorImageInfo mip0Info{ VK_NULL_HANDLE, pyramidMipViews[0], VK_IMAGE_LAYOUT_GENERAL };
+		VeDescriptorWriter(*downsampleSetLayout, *cullDescriptorPool)
+			.writeImage(0, &depthInfo)
+			.writeImage(1, &mip0Info)
+			.overwrite(frame.depthDownsampleSet);
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = pyramidImage;
+
+		// earlier culls read the whole pyramid before it is overwritten
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidMipCount, 0, 1 };
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsamplePipeline);
+		for (uint32_t mip = 0; mip < pyramidMipCount; mip++) {
+			VkDescriptorSet set = mip == 0 ? frame.depthDownsampleSet : pyramidMipSets[mip];
+			vkCmdBindDescriptorSets(
+				commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsamplePipelineLayout, 0, 1, &set, 0, nullptr);
+
+			DownsamplePush push{};
+			push.outputSize = glm::uvec2(
+				std::max(pyramidExtent.width >> mip, 1u),
+				std::max(pyramidExtent.height >> mip, 1u));
+			vkCmdPushConstants(
+				commandBuffer, downsamplePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DownsamplePush), &push);
+			vkCmdDispatch(
+				commandBuffer,
+				(push.outputSize.x + WORKGROUP_SIZE_2D - 1) / WORKGROUP_SIZE_2D,
+				(push.outputSize.y + WORKGROUP_SIZE_2D - 1) / WORKGROUP_SIZE_2D,
+				1);
+
+			// the next mip, or the second cull phase, reads this one
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+	}
+
+	void VeHiZCulling::cullSecondPhase(VkCommandBuffer commandBuffer, int frameIndex) {
+		dispatchCull(commandBuffer, frameIndex, 1);
+	}
+
+	void VeHiZCulling::dispatchCull(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase) {
+		auto& frame = frames[frameIndex];
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+		vkCmdBindDescriptorSets(
+			commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+
+		CullPush push{};
+		push.phase = phase;
+		push.commandOffset = phase * maxObjects;
+		push.pyramidSize = glm::vec2(static_cast<float>(pyramidExtent.width), static_cast<float>(pyramidExtent.height));
+		vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPush), &push);
+		if (frame.objectCount > 0) {
+			vkCmdDispatch(commandBuffer, (frame.objectCount + WORKGROUP_SIZE_1D - 1) / WORKGROUP_SIZE_1D, 1, 1);
+		}
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void VeHiZCulling::draw(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase) const {
+		uint32_t objectCount = frames[frameIndex].objectCount;
+		if (objectCount == 0) return;
+
+		// culled objects have an instance count of 0, so every object keeps its slot
+		vkCmdDrawIndexedIndirect(
+			commandBuffer,
+			drawCommandBuffer->getBuffer(),
+			phase * maxObjects * sizeof(VkDrawIndexedIndirectCommand),
+			objectCount,
+			sizeof(VkDrawIndexedIndirectCommand));
+	}
+
+} // namespace ve
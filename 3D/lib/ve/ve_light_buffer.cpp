@@ -0,0 +1,137 @@
+#include "ve/ve_light_buffer.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace ve {
+
+	VeLightBuffer::VeLightBuffer(VeDevice& device, uint32_t initialCapacity, float attenuationCutoff)
+		: veDevice{ device }, attenuationCutoff{ attenuationCutoff } {
+		frames.resize(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+		for (auto& frame : frames) {
+			createFrameBuffer(frame, std::max(initialCapacity, 1u));
+		}
+	}
+
+	void VeLightBuffer::createFrameBuffer(FrameBuffer& frame, uint32_t capacity) {
+		// slot 0 holds the count header, PointLightData and uvec4 are both 16 byte aligned in std430
+		static_assert(sizeof(PointLightData) >= sizeof(glm::uvec4), "light header must fit in one slot");
+		frame.buffer = std::make_unique<VeBuffer>(
+			veDevice,
+			sizeof(PointLightData),
+			capacity + 1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (frame.buffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map light buffer!");
+		}
+		frame.capacity = capacity;
+	}
+
+	float VeLightBuffer::lightRange(float intensity, const glm::vec3& color) const {
+		float brightest = intensity * std::max({ color.x, color.y, color.z });
+		return std::sqrt(std::max(brightest, 0.f) / attenuationCutoff);
+	}
+
+	void VeLightBuffer::sync(VeGameObject::Map& gameObjects) {
+		for (auto& kv : gameObjects) {
+			auto& obj = kv.second;
+			if (obj.pointLight == nullptr) continue;
+
+			PointLightData light{};
+			light.position = glm::vec4(obj.transform.translation, lightRange(obj.pointLight->lightIntensity, obj.color));
+			light.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
+			setLight(kv.first, light);
+		}
+
+		removedScratch.clear();
+		for (auto& kv : slots) {
+			auto it = gameObjects.find(kv.first);
+			if (it == gameObjects.end() || it->second.pointLight == nullptr) {
+				removedScratch.push_back(kv.first);
+			}
+		}
+		for (auto id : removedScratch) {
+			removeLight(id);
+		}
+	}
+
+	void VeLightBuffer::setLight(VeGameObject::id_t id, const PointLightData& light) {
+		auto it = slots.find(id);
+		if (it == slots.end()) {
+			uint32_t slot = static_cast<uint32_t>(lights.size());
+			slots.emplace(id, slot);
+			lights.push_back(light);
+			slotOwners.push_back(id);
+			markDirty(slot);
+			return;
+		}
+		if (lights[it->second] != light) {
+			lights[it->second] = light;
+			markDirty(it->second);
+		}
+	}
+
+	void VeLightBuffer::removeLight(VeGameObject::id_t id) {
+		auto it = slots.find(id);
+		if (it == slots.end()) return;
+
+		// swap the last light into the hole to keep the array dense
+		uint32_t slot = it->second;
+		uint32_t last = static_cast<uint32_t>(lights.size()) - 1;
+		slots.erase(it);
+		if (slot != last) {
+			lights[slot] = lights[last];
+			slotOwners[slot] = slotOwners[last];
+			slots[slotOwners[slot]] = slot;
+			markDirty(slot);
+		}
+		lights.pop_back();
+		slotOwners.pop_back();
+	}
+
+	void VeLightBuffer::markDirty(uint32_t slot) {
+		for (auto& frame : frames) {
+			if (slot >= frame.isDirty.size()) {
+				frame.isDirty.resize(slot + 1, false);
+			}
+			if (!frame.isDirty[slot]) {
+				frame.isDirty[slot] = true;
+				frame.dirtySlots.push_back(slot);
+			}
+		}
+	}
+
+	void VeLightBuffer::flush(int frameIndex) {
+		auto& frame = frames[frameIndex];
+		uint32_t lightCount = getLightCount();
+
+		auto* lightMemory = static_cast<PointLightData*>(frame.buffer->getMappedMemory()) + 1;
+		if (lightCount > frame.capacity) {
+			// this frame's fence has signalled, so its old buffer is no longer in use
+			createFrameBuffer(frame, std::max(frame.capacity * 2, lightCount));
+			lightMemory = static_cast<PointLightData*>(frame.buffer->getMappedMemory()) + 1;
+			memcpy(lightMemory, lights.data(), lightCount * sizeof(PointLightData));
+		}
+		else {
+			for (auto slot : frame.dirtySlots) {
+				if (slot < lightCount) {
+					lightMemory[slot] = lights[slot];
+				}
+			}
+		}
+		for (auto slot : frame.dirtySlots) {
+			frame.isDirty[slot] = false;
+		}
+		frame.dirtySlots.clear();
+
+		glm::uvec4 header{ lightCount, 0, 0, 0 };
+		memcpy(frame.buffer->getMappedMemory(), &header, sizeof(header));
+	}
+
+} // namespace ve
@@ -50,6 +50,16 @@ namespace ve {
 		}
 	}
 
+	void VeModel::bindPositions(VkCommandBuffer commandBuffer) {
+		VkBuffer buffers[] = { positionBuffer->getBuffer() };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+		if (hasIndexBuffer) {
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		}
+	}
+
 	void VeModel::draw(VkCommandBuffer commandBuffer) {
 		if (hasIndexBuffer) {
 			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
@@ -84,6 +94,33 @@ namespace ve {
 		);
 
 		veDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+
+		std::vector<glm::vec3> positions(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			positions[i] = vertices[i].position;
+		}
+		uint32_t positionSize = sizeof(positions[0]);
+
+		VeBuffer positionStagingBuffer{
+			veDevice,
+			positionSize,
+			vertexCount,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		};
+
+		positionStagingBuffer.map();
+		positionStagingBuffer.writeToBuffer((void*)positions.data());
+
+		positionBuffer = std::make_unique<VeBuffer>(
+			veDevice,
+			positionSize,
+			vertexCount,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+
+		veDevice.copyBuffer(positionStagingBuffer.getBuffer(), positionBuffer->getBuffer(), positionSize * vertexCount);
 	}
 
 	void VeModel::createIndexBuffers(const std::vector<uint32_t>& indices) {
@@ -137,6 +174,18 @@ namespace ve {
 		return attributeDescriptions;
 	}
 
+	std::vector<VkVertexInputBindingDescription> VeModel::Vertex::getPositionBindingDescriptions() {
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(glm::vec3);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> VeModel::Vertex::getPositionAttributeDescriptions() {
+		return { { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 } };
+	}
+
 	void VeModel::Builder::loadModel(const std::string& filePath) {
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
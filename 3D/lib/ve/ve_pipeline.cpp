@@ -1,21 +1,185 @@
 #include "ve/ve_pipeline.hpp"
 #include "ve/ve_model.hpp"
+#include "ve/ve_utils.hpp"
 
 // std
-#include <fstream>
 #include <stdexcept>
 #include <iostream>
 #include <cassert>
 
 
 namespace ve {
+
+	namespace {
+
+		bool equalStencilOps(const VkStencilOpState& a, const VkStencilOpState& b) {
+			return a.failOp == b.failOp && a.passOp == b.passOp && a.depthFailOp == b.depthFailOp &&
+				a.compareOp == b.compareOp && a.compareMask == b.compareMask && a.writeMask == b.writeMask &&
+				a.reference == b.reference;
+		}
+
+		void hashStencilOps(size_t& seed, const VkStencilOpState& s) {
+			hashCombine(seed, s.failOp, s.passOp, s.depthFailOp, s.compareOp, s.compareMask, s.writeMask, s.reference);
+		}
+
+	} // namespace
+
+	VkSpecializationInfo ShaderSpecialization::getSpecializationInfo() const {
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+		specializationInfo.pMapEntries = mapEntries.data();
+		specializationInfo.dataSize = data.size();
+		specializationInfo.pData = data.data();
+		return specializationInfo;
+	}
+
+	size_t ShaderSpecialization::hash() const {
+		size_t seed = 0;
+		for (auto& entry : mapEntries) {
+			hashCombine(seed, entry.constantID, entry.offset, entry.size);
+		}
+		for (auto byte : data) {
+			hashCombine(seed, byte);
+		}
+		return seed;
+	}
+
+	bool ShaderSpecialization::operator==(const ShaderSpecialization& other) const {
+		if (mapEntries.size() != other.mapEntries.size() || data != other.data) {
+			return false;
+		}
+		for (size_t i = 0; i < mapEntries.size(); i++) {
+			if (mapEntries[i].constantID != other.mapEntries[i].constantID ||
+				mapEntries[i].offset != other.mapEntries[i].offset ||
+				mapEntries[i].size != other.mapEntries[i].size) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t PipelineConfigInfo::hash() const {
+		size_t seed = 0;
+		for (auto& binding : bindingDescriptions) {
+			hashCombine(seed, binding.binding, binding.stride, binding.inputRate);
+		}
+		for (auto& attribute : attributeDescriptions) {
+			hashCombine(seed, attribute.location, attribute.binding, attribute.format, attribute.offset);
+		}
+
+		hashCombine(seed, viewportInfo.viewportCount, viewportInfo.scissorCount);
+		hashCombine(seed, inputAssemblyInfo.topology, inputAssemblyInfo.primitiveRestartEnable);
+
+		auto& r = rasterizationInfo;
+		hashCombine(seed, r.depthClampEnable, r.rasterizerDiscardEnable, r.polygonMode, r.cullMode, r.frontFace,
+			r.depthBiasEnable, r.depthBiasConstantFactor, r.depthBiasClamp, r.depthBiasSlopeFactor, r.lineWidth);
+
+		auto& m = multisampleInfo;
+		hashCombine(seed, m.rasterizationSamples, m.sampleShadingEnable, m.minSampleShading,
+			m.alphaToCoverageEnable, m.alphaToOneEnable);
+
+		auto& a = colorBlendAttachment;
+		hashCombine(seed, a.blendEnable, a.srcColorBlendFactor, a.dstColorBlendFactor, a.colorBlendOp,
+			a.srcAlphaBlendFactor, a.dstAlphaBlendFactor, a.alphaBlendOp, a.colorWriteMask);
+
+		auto& c = colorBlendInfo;
+		hashCombine(seed, c.logicOpEnable, c.logicOp, c.attachmentCount,
+			c.blendConstants[0], c.blendConstants[1], c.blendConstants[2], c.blendConstants[3]);
+
+		auto& d = depthStencilInfo;
+		hashCombine(seed, d.depthTestEnable, d.depthWriteEnable, d.depthCompareOp, d.depthBoundsTestEnable,
+			d.stencilTestEnable, d.minDepthBounds, d.maxDepthBounds);
+		hashStencilOps(seed, d.front);
+		hashStencilOps(seed, d.back);
+
+		for (auto state : dynamicStateEnables) {
+			hashCombine(seed, state);
+		}
+
+		hashCombine(seed, pipelineLayout, renderPass, subpass, vertSpecialization.hash(), fragSpecialization.hash());
+		for (auto format : colorAttachmentFormats) {
+			hashCombine(seed, format);
+		}
+		hashCombine(seed, depthAttachmentFormat);
+		return seed;
+	}
+
+	bool PipelineConfigInfo::operator==(const PipelineConfigInfo& other) const {
+		if (bindingDescriptions.size() != other.bindingDescriptions.size() ||
+			attributeDescriptions.size() != other.attributeDescriptions.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < bindingDescriptions.size(); i++) {
+			auto& a = bindingDescriptions[i];
+			auto& b = other.bindingDescriptions[i];
+			if (a.binding != b.binding || a.stride != b.stride || a.inputRate != b.inputRate) {
+				return false;
+			}
+		}
+		for (size_t i = 0; i < attributeDescriptions.size(); i++) {
+			auto& a = attributeDescriptions[i];
+			auto& b = other.attributeDescriptions[i];
+			if (a.location != b.location || a.binding != b.binding || a.format != b.format || a.offset != b.offset) {
+				return false;
+			}
+		}
+
+		auto& r = rasterizationInfo;
+		auto& ro = other.rasterizationInfo;
+		auto& m = multisampleInfo;
+		auto& mo = other.multisampleInfo;
+		auto& a = colorBlendAttachment;
+		auto& ao = other.colorBlendAttachment;
+		auto& c = colorBlendInfo;
+		auto& co = other.colorBlendInfo;
+		auto& d = depthStencilInfo;
+		auto& dOther = other.depthStencilInfo;
+
+		return viewportInfo.viewportCount == other.viewportInfo.viewportCount &&
+			viewportInfo.scissorCount == other.viewportInfo.scissorCount &&
+			inputAssemblyInfo.topology == other.inputAssemblyInfo.topology &&
+			inputAssemblyInfo.primitiveRestartEnable == other.inputAssemblyInfo.primitiveRestartEnable &&
+
+			r.depthClampEnable == ro.depthClampEnable && r.rasterizerDiscardEnable == ro.rasterizerDiscardEnable &&
+			r.polygonMode == ro.polygonMode && r.cullMode == ro.cullMode && r.frontFace == ro.frontFace &&
+			r.depthBiasEnable == ro.depthBiasEnable && r.depthBiasConstantFactor == ro.depthBiasConstantFactor &&
+			r.depthBiasClamp == ro.depthBiasClamp && r.depthBiasSlopeFactor == ro.depthBiasSlopeFactor &&
+			r.lineWidth == ro.lineWidth &&
+
+			m.rasterizationSamples == mo.rasterizationSamples && m.sampleShadingEnable == mo.sampleShadingEnable &&
+			m.minSampleShading == mo.minSampleShading && m.alphaToCoverageEnable == mo.alphaToCoverageEnable &&
+			m.alphaToOneEnable == mo.alphaToOneEnable &&
+
+			a.blendEnable == ao.blendEnable && a.srcColorBlendFactor == ao.srcColorBlendFactor &&
+			a.dstColorBlendFactor == ao.dstColorBlendFactor && a.colorBlendOp == ao.colorBlendOp &&
+			a.srcAlphaBlendFactor == ao.srcAlphaBlendFactor && a.dstAlphaBlendFactor == ao.dstAlphaBlendFactor &&
+			a.alphaBlendOp == ao.alphaBlendOp && a.colorWriteMask == ao.colorWriteMask &&
+
+			c.logicOpEnable == co.logicOpEnable && c.logicOp == co.logicOp && c.attachmentCount == co.attachmentCount &&
+			c.blendConstants[0] == co.blendConstants[0] && c.blendConstants[1] == co.blendConstants[1] &&
+			c.blendConstants[2] == co.blendConstants[2] && c.blendConstants[3] == co.blendConstants[3] &&
+
+			d.depthTestEnable == dOther.depthTestEnable && d.depthWriteEnable == dOther.depthWriteEnable &&
+			d.depthCompareOp == dOther.depthCompareOp && d.depthBoundsTestEnable == dOther.depthBoundsTestEnable &&
+			d.stencilTestEnable == dOther.stencilTestEnable && d.minDepthBounds == dOther.minDepthBounds &&
+			d.maxDepthBounds == dOther.maxDepthBounds &&
+			equalStencilOps(d.front, dOther.front) && equalStencilOps(d.back, dOther.back) &&
+
+			dynamicStateEnables == other.dynamicStateEnables &&
+			pipelineLayout == other.pipelineLayout &&
+			renderPass == other.renderPass &&
+			subpass == other.subpass &&
+			colorAttachmentFormats == other.colorAttachmentFormats &&
+			depthAttachmentFormat == other.depthAttachmentFormat &&
+			vertSpecialization == other.vertSpecialization &&
+			fragSpecialization == other.fragSpecialization;
+	}
+
 	VePipeline::VePipeline(VeDevice& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo) : veDevice(device) {
 		createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
 	}
 
 	VePipeline::~VePipeline() {
-		vkDestroyShaderModule(veDevice.device(), fragShaderModule, nullptr);
-		vkDestroyShaderModule(veDevice.device(), vertShaderModule, nullptr);
 		vkDestroyPipeline(veDevice.device(), graphicsPipeline, nullptr);
 	}
 
@@ -95,50 +259,67 @@ namespace ve {
 		configInfo.attributeDescriptions = VeModel::Vertex::getAttributeDescriptions();
 	}
 
-	std::vector<char> VePipeline::readFile(const std::string& filepath) {
-		std::ifstream file{ filepath, std::ios::ate | std::ios::binary };
+	void VePipeline::depthPrePassPipelineConfigInfo(PipelineConfigInfo& configInfo) {
+		defaultPipelineConfigInfo(configInfo);
 
-		if (!file.is_open()) {
-			throw std::runtime_error("failed to open file: " + filepath);
-		}
+		configInfo.colorBlendInfo.attachmentCount = 0;
+		configInfo.colorBlendInfo.pAttachments = nullptr;
 
-		size_t fileSize = static_cast<size_t>(file.tellg());
-		std::vector<char> buffer(fileSize);
+		configInfo.bindingDescriptions = VeModel::Vertex::getPositionBindingDescriptions();
+		configInfo.attributeDescriptions = VeModel::Vertex::getPositionAttributeDescriptions();
+	}
 
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
+	void VePipeline::enableDepthEqualTest(PipelineConfigInfo& configInfo) {
+		configInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+	}
 
-		file.close();
-		return buffer;
+	void VePipeline::enableMultisampling(PipelineConfigInfo& configInfo, VkSampleCountFlagBits samples) {
+		configInfo.multisampleInfo.rasterizationSamples = samples;
+	}
+
+	void VePipeline::enableDynamicRendering(
+		PipelineConfigInfo& configInfo,
+		const std::vector<VkFormat>& colorFormats,
+		VkFormat depthFormat) {
+		configInfo.renderPass = nullptr;
+		configInfo.subpass = 0;
+		configInfo.colorAttachmentFormats = colorFormats;
+		configInfo.depthAttachmentFormat = depthFormat;
 	}
 
 	void VePipeline::createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo) {
 		
 		assert(configInfo.pipelineLayout != nullptr && "Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
-		assert(configInfo.renderPass != nullptr && "Cannot create graphics pipeline:: no renderPass provided in configInfo");
+		assert((configInfo.renderPass != nullptr ||
+			!configInfo.colorAttachmentFormats.empty() ||
+			configInfo.depthAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+			"Cannot create graphics pipeline:: no renderPass or attachment formats provided in configInfo");
+		assert((configInfo.renderPass != nullptr || veDevice.supportsDynamicRendering()) &&
+			"Cannot create graphics pipeline:: dynamic rendering is not supported by the device");
 
-		auto vertCode = readFile(vertFilepath);
-		auto fragCode = readFile(fragFilepath);
+		vertShaderModule = veDevice.shaderCache().getShaderModule(vertFilepath);
+		fragShaderModule = veDevice.shaderCache().getShaderModule(fragFilepath);
 
-		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
+		auto vertSpecializationInfo = configInfo.vertSpecialization.getSpecializationInfo();
+		auto fragSpecializationInfo = configInfo.fragSpecialization.getSpecializationInfo();
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		shaderStages[0].module = vertShaderModule;
+		shaderStages[0].module = vertShaderModule->getShaderModule();
 		shaderStages[0].pName = "main";
 		shaderStages[0].flags = 0;
 		shaderStages[0].pNext = nullptr;
-		shaderStages[0].pSpecializationInfo = nullptr;
+		shaderStages[0].pSpecializationInfo = configInfo.vertSpecialization.empty() ? nullptr : &vertSpecializationInfo;
 
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStages[1].module = fragShaderModule;
+		shaderStages[1].module = fragShaderModule->getShaderModule();
 		shaderStages[1].pName = "main";
 		shaderStages[1].flags = 0;
 		shaderStages[1].pNext = nullptr;
-		shaderStages[1].pSpecializationInfo = nullptr;
+		shaderStages[1].pSpecializationInfo = configInfo.fragSpecialization.empty() ? nullptr : &fragSpecializationInfo;
 
 		auto& bindingDescriptions = configInfo.bindingDescriptions;
 		auto& attributeDescriptions = configInfo.attributeDescriptions;
@@ -149,6 +330,16 @@ namespace ve {
 		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
+		// configInfo may be a copy, so point the nested state at its own members rather than trusting
+		// whatever pAttachments/pDynamicStates were left pointing at
+		assert(configInfo.colorBlendInfo.attachmentCount <= 1 && "PipelineConfigInfo holds a single colorBlendAttachment");
+		VkPipelineColorBlendStateCreateInfo colorBlendInfo = configInfo.colorBlendInfo;
+		colorBlendInfo.pAttachments = colorBlendInfo.attachmentCount > 0 ? &configInfo.colorBlendAttachment : nullptr;
+
+		VkPipelineDynamicStateCreateInfo dynamicStateInfo = configInfo.dynamicStateInfo;
+		dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
+		dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
+
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 		pipelineInfo.stageCount = 2;
@@ -158,31 +349,30 @@ namespace ve {
 		pipelineInfo.pViewportState = &configInfo.viewportInfo;
 		pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
 		pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
-		pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+		pipelineInfo.pColorBlendState = &colorBlendInfo;
 		pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
-		pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
+		pipelineInfo.pDynamicState = &dynamicStateInfo;
 
 		pipelineInfo.layout = configInfo.pipelineLayout;
 		pipelineInfo.renderPass = configInfo.renderPass;
 		pipelineInfo.subpass = configInfo.subpass;
 
+		VkPipelineRenderingCreateInfo renderingInfo{};
+		if (configInfo.renderPass == nullptr) {
+			renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+			renderingInfo.colorAttachmentCount = static_cast<uint32_t>(configInfo.colorAttachmentFormats.size());
+			renderingInfo.pColorAttachmentFormats = configInfo.colorAttachmentFormats.data();
+			renderingInfo.depthAttachmentFormat = configInfo.depthAttachmentFormat;
+			renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+			pipelineInfo.pNext = &renderingInfo;
+		}
+
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 		pipelineInfo.basePipelineIndex = -1;
 
-		if (vkCreateGraphicsPipelines(veDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+		if (vkCreateGraphicsPipelines(veDevice.device(), veDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create graphics pipeline!");
 		}
 	}
 
-	void VePipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-		if (vkCreateShaderModule(veDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create shader module!");
-		}
-	}
-
 } // namespace ve
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "ve/ve_pipeline_cache.hpp"
+#include "ve/ve_utils.hpp"
+
+// std
+#include <chrono>
+#include <filesystem>
+
+
+namespace ve {
+
+	size_t VePipelineCache::KeyHash::operator()(const Key& key) const {
+		size_t seed = 0;
+		hashCombine(seed, key.vertFilepath, key.fragFilepath, key.configInfo.hash());
+		return seed;
+	}
+
+	std::shared_ptr<VePipeline> VePipelineCache::getPipeline(
+		const std::string& vertFilepath,
+		const std::string& fragFilepath,
+		const PipelineConfigInfo& configInfo) {
+		Key key{ vertFilepath, fragFilepath, configInfo };
+
+		// the entry is inserted before compiling, so other threads asking for the same pipeline wait on it
+		// while lookups of any other pipeline never wait for a compile
+		std::promise<std::shared_ptr<VePipeline>> promise;
+		std::shared_future<std::shared_ptr<VePipeline>> existing;
+		{
+			std::lock_guard<std::mutex> lock{ cacheMutex };
+			auto [it, inserted] = pipelines.emplace(key, promise.get_future().share());
+			if (!inserted) {
+				existing = it->second;
+			}
+		}
+		if (existing.valid()) {
+			return existing.get();
+		}
+
+		try {
+			auto pipeline = std::make_shared<VePipeline>(veDevice, vertFilepath, fragFilepath, configInfo);
+			promise.set_value(pipeline);
+			return pipeline;
+		} catch (...) {
+			promise.set_exception(std::current_exception());
+			// failed entries are dropped so the next request tries again
+			std::lock_guard<std::mutex> lock{ cacheMutex };
+			auto it = pipelines.find(key);
+			if (it != pipelines.end() && it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				try {
+					it->second.get();
+				} catch (...) {
+					pipelines.erase(it);
+				}
+			}
+			throw;
+		}
+	}
+
+	void VePipelineCache::invalidate(const std::string& shaderFilepath) {
+		auto samePath = [](const std::string& a, const std::string& b) {
+			std::error_code error;
+			return std::filesystem::equivalent(a, b, error);
+		};
+
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		for (auto it = pipelines.begin(); it != pipelines.end();) {
+			bool stale = samePath(it->first.vertFilepath, shaderFilepath) || samePath(it->first.fragFilepath, shaderFilepath);
+			it = stale ? pipelines.erase(it) : std::next(it);
+		}
+	}
+
+	void VePipelineCache::clear() {
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		pipelines.clear();
+	}
+
+	size_t VePipelineCache::size() {
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		return pipelines.size();
+	}
+
+} // namespace ve
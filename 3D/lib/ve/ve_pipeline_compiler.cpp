@@ -0,0 +1,114 @@
+#include "ve/ve_pipeline_compiler.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+
+
+namespace ve {
+
+	// ******************************	Async Pipeline		*************************************** //
+	VeAsyncPipeline::VeAsyncPipeline(std::future<std::unique_ptr<VePipeline>> pending, VePipeline* fallback)
+		: pending{ std::move(pending) }, fallback{ fallback } {}
+
+	bool VeAsyncPipeline::isReady() {
+		if (pipeline != nullptr) {
+			return true;
+		}
+		if (!pending.valid() || pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return false;
+		}
+		pipeline = pending.get();
+		return true;
+	}
+
+	void VeAsyncPipeline::wait() {
+		if (pending.valid()) {
+			pending.wait();
+		}
+	}
+
+	VePipeline* VeAsyncPipeline::get() {
+		return isReady() ? pipeline.get() : nullptr;
+	}
+
+	bool VeAsyncPipeline::bind(VkCommandBuffer commandBuffer) {
+		if (auto* compiled = get()) {
+			compiled->bind(commandBuffer);
+			return true;
+		}
+		if (fallback != nullptr) {
+			fallback->bind(commandBuffer);
+			return true;
+		}
+		return false;
+	}
+
+
+	// ******************************	Pipeline Compiler	*************************************** //
+	VePipelineCompiler::VePipelineCompiler(VeDevice& device, uint32_t workerCount) : veDevice{ device } {
+		if (workerCount == 0) {
+			// leave one core for the render thread
+			const uint32_t coreCount = std::thread::hardware_concurrency();
+			workerCount = coreCount > 1 ? coreCount - 1 : 1;
+		}
+
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++) {
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	VePipelineCompiler::~VePipelineCompiler() {
+		{
+			std::lock_guard<std::mutex> lock{ queueMutex };
+			stopping = true;
+		}
+		queueCondition.notify_all();
+
+		// workers drain the queue before exiting so every handed out future is fulfilled
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	std::shared_ptr<VeAsyncPipeline> VePipelineCompiler::compile(
+		const std::string& vertFilepath,
+		const std::string& fragFilepath,
+		const PipelineConfigInfo& configInfo,
+		VePipeline* fallback) {
+		// std::function requires a copyable callable, so the move-only task lives behind a shared_ptr
+		auto task = std::make_shared<std::packaged_task<std::unique_ptr<VePipeline>()>>(
+			[this, vertFilepath, fragFilepath, config = configInfo]() {
+				// all workers share VeDevice's pipeline cache, which vulkan synchronizes internally
+				return std::make_unique<VePipeline>(veDevice, vertFilepath, fragFilepath, config);
+			});
+		auto result = std::make_shared<VeAsyncPipeline>(task->get_future(), fallback);
+
+		{
+			std::lock_guard<std::mutex> lock{ queueMutex };
+			assert(!stopping && "Cannot compile pipeline on a stopped compiler");
+			tasks.emplace([task]() { (*task)(); });
+		}
+		queueCondition.notify_one();
+
+		return result;
+	}
+
+	void VePipelineCompiler::workerLoop() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock{ queueMutex };
+				queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty()) {
+					return;
+				}
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
+	}
+
+} // namespace ve
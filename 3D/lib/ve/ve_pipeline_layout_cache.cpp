@@ -0,0 +1,164 @@
+#include "ve/ve_pipeline_layout_cache.hpp"
+#include "ve/ve_shader_cache.hpp"
+#include "ve/ve_utils.hpp"
+
+// std
+#include <algorithm>
+#include <map>
+#include <string>
+#include <stdexcept>
+
+
+namespace ve {
+
+	VePipelineLayoutCache::~VePipelineLayoutCache() {
+		for (auto& kv : pipelineLayouts) {
+			vkDestroyPipelineLayout(veDevice.device(), kv.second.pipelineLayout, nullptr);
+		}
+	}
+
+	size_t VePipelineLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+		size_t seed = 0;
+		for (auto word : key) {
+			hashCombine(seed, word);
+		}
+		return seed;
+	}
+
+	void VePipelineLayoutCache::setExternalSetLayout(uint32_t set, VeDescriptorSetLayout* setLayout) {
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		assert(pipelineLayouts.empty() && "External set layouts must be registered before pipeline layouts are created");
+		externalSetLayouts[set] = setLayout;
+	}
+
+	const ReflectedPipelineLayout& VePipelineLayoutCache::getPipelineLayout(
+		const std::vector<const ShaderReflection*>& stages) {
+		std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> sets{};
+		std::vector<VkPushConstantRange> pushConstantRanges{};
+
+		for (auto* stage : stages) {
+			for (auto& [set, bindings] : stage->descriptorSets) {
+				if (externalSetLayouts.count(set)) {
+					sets[set];
+					continue;
+				}
+				for (auto& [index, binding] : bindings) {
+					auto [it, inserted] = sets[set].emplace(index, binding);
+					if (inserted) continue;
+
+					if (it->second.descriptorType != binding.descriptorType ||
+						it->second.descriptorCount != binding.descriptorCount) {
+						throw std::runtime_error("descriptor binding mismatch between shader stages!");
+					}
+					it->second.stageFlags |= binding.stageFlags;
+				}
+			}
+
+			// a single range covering every stage's block keeps vkCmdPushConstants calls unchanged
+			if (stage->pushConstantRange.has_value()) {
+				const auto& range = *stage->pushConstantRange;
+				if (pushConstantRanges.empty()) {
+					pushConstantRanges.push_back(range);
+				} else {
+					auto& merged = pushConstantRanges[0];
+					uint32_t end = std::max(merged.offset + merged.size, range.offset + range.size);
+					merged.offset = std::min(merged.offset, range.offset);
+					merged.size = end - merged.offset;
+					merged.stageFlags |= range.stageFlags;
+				}
+			}
+		}
+
+		ReflectedPipelineLayout layout{};
+		layout.pushConstantRanges = pushConstantRanges;
+		uint32_t setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+		for (uint32_t set = 0; set < setCount; set++) {
+			auto external = externalSetLayouts.find(set);
+			if (external != externalSetLayouts.end()) {
+				layout.setLayouts.push_back(external->second);
+				continue;
+			}
+			std::vector<VkDescriptorSetLayoutBinding> bindings{};
+			for (auto& kv : sets[set]) {
+				bindings.push_back(kv.second);
+			}
+			layout.setLayouts.push_back(&setLayoutCache.getLayout(bindings));
+		}
+
+		LayoutKey key{};
+		for (auto* setLayout : layout.setLayouts) {
+			key.push_back((uint64_t)setLayout->getDescriptorSetLayout());
+		}
+		for (auto& range : pushConstantRanges) {
+			key.insert(key.end(), { range.stageFlags, range.offset, range.size });
+		}
+
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+		auto it = pipelineLayouts.find(key);
+		if (it != pipelineLayouts.end()) {
+			return it->second;
+		}
+
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{};
+		for (auto* setLayout : layout.setLayouts) {
+			descriptorSetLayouts.push_back(setLayout->getDescriptorSetLayout());
+		}
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+		pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+		if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, nullptr, &layout.pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+		return pipelineLayouts.emplace(std::move(key), std::move(layout)).first->second;
+	}
+
+	const ReflectedPipelineLayout& VePipelineLayoutCache::configure(
+		PipelineConfigInfo& configInfo,
+		const std::string& vertFilepath,
+		const std::string& fragFilepath) {
+		auto vertShader = veDevice.shaderCache().getShaderModule(vertFilepath);
+		auto fragShader = veDevice.shaderCache().getShaderModule(fragFilepath);
+
+		const auto& layout = getPipelineLayout({ &vertShader->getReflection(), &fragShader->getReflection() });
+		configInfo.pipelineLayout = layout.pipelineLayout;
+		configureVertexInput(configInfo, vertShader->getReflection());
+		return layout;
+	}
+
+	void VePipelineLayoutCache::configureVertexInput(
+		PipelineConfigInfo& configInfo,
+		const ShaderReflection& vertReflection) const {
+		if (configInfo.attributeDescriptions.empty()) {
+			uint32_t offset = 0;
+			for (auto& input : vertReflection.vertexInputs) {
+				configInfo.attributeDescriptions.push_back({ input.location, 0, input.format, offset });
+				offset += input.size;
+			}
+			configInfo.bindingDescriptions.clear();
+			if (offset > 0) {
+				configInfo.bindingDescriptions.push_back({ 0, offset, VK_VERTEX_INPUT_RATE_VERTEX });
+			}
+			return;
+		}
+
+		// unused attributes cost vertex fetch bandwidth, missing ones are undefined behaviour
+		std::vector<VkVertexInputAttributeDescription> attributes{};
+		for (auto& input : vertReflection.vertexInputs) {
+			auto it = std::find_if(
+				configInfo.attributeDescriptions.begin(),
+				configInfo.attributeDescriptions.end(),
+				[&](const auto& attribute) { return attribute.location == input.location; });
+			if (it == configInfo.attributeDescriptions.end()) {
+				throw std::runtime_error("vertex shader input location " + std::to_string(input.location) + " has no vertex attribute!");
+			}
+			attributes.push_back(*it);
+		}
+		configInfo.attributeDescriptions = attributes;
+	}
+
+} // namespace ve
@@ -0,0 +1,821 @@
+#include "ve/ve_render_graph.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace ve {
+
+	namespace {
+		template <typename T>
+		uint64_t handleKey(T handle) {
+			uint64_t key = 0;
+			memcpy(&key, &handle, sizeof(handle));
+			return key;
+		}
+
+		bool isAttachmentAccess(VeRenderGraphAccess access) {
+			return access == VeRenderGraphAccess::ColorAttachment ||
+				access == VeRenderGraphAccess::DepthAttachment ||
+				access == VeRenderGraphAccess::DepthReadOnly;
+		}
+	} // namespace
+
+	// *************** Pass Builder *********************
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::writeColor(ResourceHandle image) {
+		graph.addUse(pass, { image, VeRenderGraphAccess::ColorAttachment, true });
+		return *this;
+	}
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::writeColor(ResourceHandle image, const VkClearColorValue& clearValue) {
+		Use use{ image, VeRenderGraphAccess::ColorAttachment, true };
+		use.clear = true;
+		use.clearValue.color = clearValue;
+		graph.addUse(pass, use);
+		return *this;
+	}
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::writeDepth(ResourceHandle image) {
+		graph.addUse(pass, { image, VeRenderGraphAccess::DepthAttachment, true });
+		return *this;
+	}
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::writeDepth(ResourceHandle image, const VkClearDepthStencilValue& clearValue) {
+		Use use{ image, VeRenderGraphAccess::DepthAttachment, true };
+		use.clear = true;
+		use.clearValue.depthStencil = clearValue;
+		graph.addUse(pass, use);
+		return *this;
+	}
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::readDepth(ResourceHandle image) {
+		graph.addUse(pass, { image, VeRenderGraphAccess::DepthReadOnly, false });
+		return *this;
+	}
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::read(ResourceHandle resource, VeRenderGraphAccess access) {
+		graph.addUse(pass, { resource, access, false });
+		return *this;
+	}
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::write(ResourceHandle resource, VeRenderGraphAccess access) {
+		graph.addUse(pass, { resource, access, true });
+		return *this;
+	}
+
+	VeRenderGraph::PassBuilder& VeRenderGraph::PassBuilder::setSideEffect() {
+		graph.passes[pass].sideEffect = true;
+		return *this;
+	}
+
+	// *************** Render Graph *********************
+
+	VeRenderGraph::~VeRenderGraph() {
+		destroyFramebuffers();
+		destroyTransientImages();
+		for (auto& kv : renderPassCache) {
+			vkDestroyRenderPass(veDevice.device(), kv.second, nullptr);
+		}
+	}
+
+	VeRenderGraph::ResourceHandle VeRenderGraph::addResource(Resource resource) {
+		assert(!compiled && "Resources must be declared before compile()");
+		resources.push_back(std::move(resource));
+		return static_cast<ResourceHandle>(resources.size() - 1);
+	}
+
+	VeRenderGraph::ResourceHandle VeRenderGraph::createImage(const std::string& name, const ImageDesc& desc) {
+		Resource resource{};
+		resource.name = name;
+		resource.desc = desc;
+		return addResource(std::move(resource));
+	}
+
+	VeRenderGraph::ResourceHandle VeRenderGraph::importImage(
+		const std::string& name,
+		VkFormat format,
+		VkImageLayout initialLayout,
+		VkImageLayout finalLayout,
+		VkPipelineStageFlags initialStage) {
+		Resource resource{};
+		resource.name = name;
+		resource.imported = true;
+		resource.desc.format = format;
+		resource.initialLayout = initialLayout;
+		resource.finalLayout = finalLayout;
+		resource.initialStage = initialStage;
+		return addResource(std::move(resource));
+	}
+
+	VeRenderGraph::ResourceHandle VeRenderGraph::importBuffer(const std::string& name) {
+		Resource resource{};
+		resource.name = name;
+		resource.type = ResourceType::Buffer;
+		resource.imported = true;
+		return addResource(std::move(resource));
+	}
+
+	void VeRenderGraph::setImportedImage(ResourceHandle image, VkImage vkImage, VkImageView view) {
+		assert(resources[image].imported && resources[image].type == ResourceType::Image && "Not an imported image");
+		resources[image].image = vkImage;
+		resources[image].view = view;
+	}
+
+	void VeRenderGraph::setImportedBuffer(ResourceHandle buffer, VkBuffer vkBuffer) {
+		assert(resources[buffer].imported && resources[buffer].type == ResourceType::Buffer && "Not an imported buffer");
+		resources[buffer].buffer = vkBuffer;
+	}
+
+	VeRenderGraph::PassBuilder VeRenderGraph::addGraphicsPass(const std::string& name, ExecuteFunction execute) {
+		assert(!compiled && "Passes must be declared before compile()");
+		Pass pass{};
+		pass.name = name;
+		pass.graphics = true;
+		pass.execute = std::move(execute);
+		passes.push_back(std::move(pass));
+		return PassBuilder(*this, static_cast<PassHandle>(passes.size() - 1));
+	}
+
+	VeRenderGraph::PassBuilder VeRenderGraph::addComputePass(const std::string& name, ExecuteFunction execute) {
+		assert(!compiled && "Passes must be declared before compile()");
+		Pass pass{};
+		pass.name = name;
+		pass.graphics = false;
+		pass.execute = std::move(execute);
+		passes.push_back(std::move(pass));
+		return PassBuilder(*this, static_cast<PassHandle>(passes.size() - 1));
+	}
+
+	void VeRenderGraph::addUse(PassHandle pass, const Use& use) {
+		assert(use.resource < resources.size() && "Unknown render graph resource");
+		assert((!isAttachmentAccess(use.access) || passes[pass].graphics) && "Attachments need a graphics pass");
+		assert((resources[use.resource].type == ResourceType::Image || !isAttachmentAccess(use.access)) &&
+			"Buffers can't be attachments");
+		for (auto& existing : passes[pass].uses) {
+			assert(existing.resource != use.resource && "A pass may use each resource only once");
+		}
+		passes[pass].uses.push_back(use);
+	}
+
+	VeRenderGraph::AccessInfo VeRenderGraph::getAccessInfo(VeRenderGraphAccess access, bool write) {
+		switch (access) {
+		case VeRenderGraphAccess::ColorAttachment:
+			return {
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | (write ? static_cast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) : static_cast<VkAccessFlags>(0)),
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+		case VeRenderGraphAccess::DepthAttachment:
+			return {
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? static_cast<VkAccessFlags>(VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT) : static_cast<VkAccessFlags>(0)),
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case VeRenderGraphAccess::DepthReadOnly:
+			return {
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case VeRenderGraphAccess::SampledFragment:
+			return {
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_USAGE_SAMPLED_BIT };
+		case VeRenderGraphAccess::SampledCompute:
+			return {
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_USAGE_SAMPLED_BIT };
+		case VeRenderGraphAccess::StorageReadCompute:
+			return {
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_USAGE_STORAGE_BIT };
+		case VeRenderGraphAccess::StorageWriteCompute:
+			return {
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT | (write ? static_cast<VkAccessFlags>(VK_ACCESS_SHADER_WRITE_BIT) : static_cast<VkAccessFlags>(0)),
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_USAGE_STORAGE_BIT };
+		case VeRenderGraphAccess::IndirectRead:
+			return {
+				VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+				VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				0 };
+		case VeRenderGraphAccess::VertexInputRead:
+			return {
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				0 };
+		case VeRenderGraphAccess::TransferRead:
+			return {
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+		case VeRenderGraphAccess::TransferWrite:
+			return {
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+		}
+		throw std::runtime_error("failed to map unknown render graph access!");
+	}
+
+	bool VeRenderGraph::isDepthFormat(VkFormat format) {
+		return format == VK_FORMAT_D16_UNORM ||
+			format == VK_FORMAT_D32_SFLOAT ||
+			format == VK_FORMAT_D16_UNORM_S8_UINT ||
+			format == VK_FORMAT_D24_UNORM_S8_UINT ||
+			format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	bool VeRenderGraph::hasStencil(VkFormat format) {
+		return format == VK_FORMAT_D16_UNORM_S8_UINT ||
+			format == VK_FORMAT_D24_UNORM_S8_UINT ||
+			format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	VkExtent2D VeRenderGraph::getImageExtent(ResourceHandle image) const {
+		const auto& desc = resources[image].desc;
+		return (desc.extent.width == 0 || desc.extent.height == 0) ? compiledExtent : desc.extent;
+	}
+
+	VkDeviceSize VeRenderGraph::getTransientMemorySize() const {
+		VkDeviceSize total = 0;
+		for (auto& block : memoryBlocks) {
+			total += block.size;
+		}
+		return total;
+	}
+
+	void VeRenderGraph::compile(VkExtent2D extent) {
+		if (compiled) {
+			// transient images and framebuffers may still be used by frames in flight
+			vkDeviceWaitIdle(veDevice.device());
+			destroyFramebuffers();
+			destroyTransientImages();
+		}
+		compiledExtent = extent;
+
+		cullPasses();
+		computeLifetimes();
+		createTransientImages();
+		computeBarriers();
+		computeLoadStoreOps();
+		createRenderPasses();
+		compiled = true;
+	}
+
+	void VeRenderGraph::cullPasses() {
+		// walking backwards, a pass is needed when it writes something a later needed pass or the outside
+		// world depends on; clearing writes end that dependency for earlier writers
+		std::vector<bool> needed(resources.size(), false);
+		for (size_t i = 0; i < resources.size(); i++) {
+			needed[i] = resources[i].imported;
+		}
+
+		for (int p = static_cast<int>(passes.size()) - 1; p >= 0; p--) {
+			auto& pass = passes[p];
+			bool keep = pass.sideEffect;
+			for (auto& use : pass.uses) {
+				keep = keep || (use.write && needed[use.resource]);
+			}
+			pass.culled = !keep;
+			if (!keep) continue;
+
+			for (auto& use : pass.uses) {
+				if (use.write && use.clear && !resources[use.resource].imported) {
+					needed[use.resource] = false;
+				}
+			}
+			for (auto& use : pass.uses) {
+				if (!use.write || !use.clear) {
+					needed[use.resource] = true;
+				}
+			}
+		}
+	}
+
+	void VeRenderGraph::computeLifetimes() {
+		for (auto& resource : resources) {
+			resource.usage = 0;
+			resource.firstPass = -1;
+			resource.lastPass = -1;
+			resource.memoryBlock = -1;
+		}
+		for (int p = 0; p < static_cast<int>(passes.size()); p++) {
+			if (passes[p].culled) continue;
+			for (auto& use : passes[p].uses) {
+				auto& resource = resources[use.resource];
+				resource.usage |= getAccessInfo(use.access, use.write).usage;
+				if (resource.firstPass < 0) {
+					resource.firstPass = p;
+				}
+				resource.lastPass = p;
+			}
+		}
+	}
+
+	void VeRenderGraph::createTransientImages() {
+		std::vector<ResourceHandle> transients;
+		for (ResourceHandle i = 0; i < resources.size(); i++) {
+			if (!resources[i].imported && resources[i].type == ResourceType::Image && resources[i].firstPass >= 0) {
+				transients.push_back(i);
+			}
+		}
+		std::sort(transients.begin(), transients.end(), [&](ResourceHandle a, ResourceHandle b) {
+			return resources[a].firstPass < resources[b].firstPass;
+		});
+
+		std::vector<VkMemoryRequirements> requirements(resources.size());
+		for (auto handle : transients) {
+			auto& resource = resources[handle];
+			VkExtent2D imageExtent = getImageExtent(handle);
+
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent.width = imageExtent.width;
+			imageInfo.extent.height = imageExtent.height;
+			imageInfo.extent.depth = 1;
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = resource.desc.format;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = resource.usage;
+			imageInfo.samples = resource.desc.samples;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			if (vkCreateImage(veDevice.device(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create render graph image!");
+			}
+			vkGetImageMemoryRequirements(veDevice.device(), resource.image, &requirements[handle]);
+
+			// greedy aliasing: reuse the smallest block whose last occupant is done before this image starts
+			const auto& reqs = requirements[handle];
+			int best = -1;
+			for (int b = 0; b < static_cast<int>(memoryBlocks.size()); b++) {
+				auto& block = memoryBlocks[b];
+				if (block.freeAfterPass >= resource.firstPass || (block.memoryTypeBits & reqs.memoryTypeBits) == 0) {
+					continue;
+				}
+				if (best < 0 || block.size < memoryBlocks[best].size) {
+					best = b;
+				}
+			}
+			if (best < 0) {
+				memoryBlocks.push_back({});
+				best = static_cast<int>(memoryBlocks.size() - 1);
+				memoryBlocks[best].firstOccupant = handle;
+				memoryBlocks[best].lastOccupant = handle;
+			}
+
+			auto& block = memoryBlocks[best];
+			block.size = std::max(block.size, reqs.size);
+			block.alignment = std::max(block.alignment, reqs.alignment);
+			block.memoryTypeBits &= reqs.memoryTypeBits;
+			block.freeAfterPass = resource.lastPass;
+			resource.previousOccupant = block.lastOccupant;
+			block.lastOccupant = handle;
+			resource.memoryBlock = best;
+		}
+
+		// a block's first image of the frame follows its last image of the previous frame
+		for (auto& block : memoryBlocks) {
+			resources[block.firstOccupant].previousOccupant = block.lastOccupant;
+
+			VkMemoryAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = block.size;
+			allocInfo.memoryTypeIndex = veDevice.findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (vkAllocateMemory(veDevice.device(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate render graph memory!");
+			}
+		}
+
+		for (auto handle : transients) {
+			auto& resource = resources[handle];
+			if (vkBindImageMemory(veDevice.device(), resource.image, memoryBlocks[resource.memoryBlock].memory, 0) != VK_SUCCESS) {
+				throw std::runtime_error("failed to bind render graph image memory!");
+			}
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = resource.image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = resource.desc.format;
+			viewInfo.subresourceRange.aspectMask =
+				isDepthFormat(resource.desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+			if (vkCreateImageView(veDevice.device(), &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create render graph image view!");
+			}
+		}
+	}
+
+	void VeRenderGraph::destroyTransientImages() {
+		for (auto& resource : resources) {
+			if (resource.imported || resource.type != ResourceType::Image) continue;
+			if (resource.view != VK_NULL_HANDLE) {
+				vkDestroyImageView(veDevice.device(), resource.view, nullptr);
+			}
+			if (resource.image != VK_NULL_HANDLE) {
+				vkDestroyImage(veDevice.device(), resource.image, nullptr);
+			}
+			resource.view = VK_NULL_HANDLE;
+			resource.image = VK_NULL_HANDLE;
+		}
+		for (auto& block : memoryBlocks) {
+			vkFreeMemory(veDevice.device(), block.memory, nullptr);
+		}
+		memoryBlocks.clear();
+	}
+
+	void VeRenderGraph::computeBarriers() {
+		std::vector<ResourceState> states(resources.size());
+		for (size_t i = 0; i < resources.size(); i++) {
+			if (resources[i].imported) {
+				// treat the semaphore wait or earlier work as a write the first use has to wait for
+				states[i].layout = resources[i].initialLayout;
+				states[i].writeStages = resources[i].type == ResourceType::Image ? resources[i].initialStage : 0;
+				states[i].hasContents = resources[i].initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+
+		// first barrier of every transient image, its source comes from the previous occupant's last use
+		std::vector<std::pair<size_t, size_t>> firstBarriers(resources.size(), { SIZE_MAX, SIZE_MAX });
+
+		for (size_t p = 0; p < passes.size(); p++) {
+			auto& pass = passes[p];
+			pass.barriers.clear();
+			if (pass.culled) continue;
+
+			for (auto& use : pass.uses) {
+				auto& resource = resources[use.resource];
+				auto& state = states[use.resource];
+				AccessInfo info = getAccessInfo(use.access, use.write);
+				bool isImage = resource.type == ResourceType::Image;
+
+				bool layoutChange = isImage && state.layout != info.layout;
+				bool needsBarrier = layoutChange;
+				if (use.write) {
+					needsBarrier = needsBarrier || state.writeStages != 0 || state.readStages != 0;
+				}
+				else {
+					needsBarrier = needsBarrier || (state.writeStages != 0 && (info.stages & ~state.syncedReadStages) != 0);
+				}
+
+				bool firstTransientUse = isImage && !resource.imported && static_cast<int>(p) == resource.firstPass;
+				if (needsBarrier || firstTransientUse) {
+					Barrier barrier{};
+					barrier.resource = use.resource;
+					barrier.oldLayout = state.layout;
+					barrier.newLayout = isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+					barrier.srcStage = state.writeStages | ((use.write || layoutChange) ? state.readStages : 0);
+					barrier.srcAccess = state.writeAccess;
+					barrier.dstStage = info.stages;
+					barrier.dstAccess = info.access;
+					if (firstTransientUse) {
+						firstBarriers[use.resource] = { p, pass.barriers.size() };
+					}
+					pass.barriers.push_back(barrier);
+				}
+
+				if (use.write || layoutChange) {
+					// a layout transition is a write the following reads have to be ordered after
+					state.writeStages = info.stages;
+					state.writeAccess = use.write ? info.access : 0;
+					state.readStages = use.write ? 0 : info.stages;
+					state.syncedReadStages = use.write ? 0 : info.stages;
+				}
+				else {
+					state.readStages |= info.stages;
+					if (needsBarrier) {
+						state.syncedReadStages |= info.stages;
+					}
+				}
+				if (isImage) {
+					state.layout = info.layout;
+				}
+				state.hasContents = state.hasContents || use.write;
+			}
+		}
+
+		for (ResourceHandle i = 0; i < resources.size(); i++) {
+			auto& first = firstBarriers[i];
+			if (first.first == SIZE_MAX) continue;
+
+			// the image's memory was last touched by its previous occupant, in this or the previous frame
+			auto& barrier = passes[first.first].barriers[first.second];
+			const auto& previous = states[resources[i].previousOccupant];
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.srcStage = previous.writeStages | previous.readStages;
+			barrier.srcAccess = previous.writeAccess;
+		}
+
+		finalBarriers.clear();
+		for (ResourceHandle i = 0; i < resources.size(); i++) {
+			auto& resource = resources[i];
+			auto& state = states[i];
+			if (!resource.imported || resource.type != ResourceType::Image) continue;
+			if (resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout) continue;
+
+			Barrier barrier{};
+			barrier.resource = i;
+			barrier.oldLayout = state.layout;
+			barrier.newLayout = resource.finalLayout;
+			barrier.srcStage = state.writeStages | state.readStages;
+			barrier.srcAccess = state.writeAccess;
+			barrier.dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			barrier.dstAccess = 0;
+			finalBarriers.push_back(barrier);
+		}
+	}
+
+	void VeRenderGraph::computeLoadStoreOps() {
+		std::vector<bool> hasContents(resources.size(), false);
+		for (size_t i = 0; i < resources.size(); i++) {
+			hasContents[i] = resources[i].imported && resources[i].initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+
+		for (size_t p = 0; p < passes.size(); p++) {
+			auto& pass = passes[p];
+			if (pass.culled) continue;
+
+			for (auto& use : pass.uses) {
+				if (!isAttachmentAccess(use.access)) {
+					hasContents[use.resource] = hasContents[use.resource] || use.write;
+					continue;
+				}
+
+				if (use.clear) {
+					use.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				}
+				else {
+					use.loadOp = hasContents[use.resource] ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				}
+
+				// stored when the outside world or a later pass that doesn't clear it sees the contents
+				bool laterUse = resources[use.resource].imported;
+				bool foundNextUse = false;
+				for (size_t q = p + 1; q < passes.size() && !foundNextUse; q++) {
+					if (passes[q].culled) continue;
+					for (auto& later : passes[q].uses) {
+						if (later.resource == use.resource) {
+							laterUse = laterUse || !later.clear;
+							foundNextUse = true;
+							break;
+						}
+					}
+				}
+				use.storeOp = laterUse ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				hasContents[use.resource] = hasContents[use.resource] || use.write;
+			}
+		}
+	}
+
+	void VeRenderGraph::createRenderPasses() {
+		for (auto& pass : passes) {
+			pass.renderPass = VK_NULL_HANDLE;
+			pass.attachments.clear();
+			pass.clearValues.clear();
+			if (pass.culled || !pass.graphics) continue;
+
+			// color attachments in declaration order, then the depth attachment
+			std::vector<const Use*> attachmentUses;
+			for (auto& use : pass.uses) {
+				if (use.access == VeRenderGraphAccess::ColorAttachment) {
+					attachmentUses.push_back(&use);
+				}
+			}
+			bool hasDepth = false;
+			for (auto& use : pass.uses) {
+				if (use.access == VeRenderGraphAccess::DepthAttachment || use.access == VeRenderGraphAccess::DepthReadOnly) {
+					assert(!hasDepth && "A pass can have only one depth attachment");
+					attachmentUses.push_back(&use);
+					hasDepth = true;
+				}
+			}
+			assert(!attachmentUses.empty() && "Graphics pass needs at least one attachment");
+
+			std::vector<VkAttachmentDescription> attachments;
+			pass.extent = getImageExtent(attachmentUses[0]->resource);
+			for (auto* use : attachmentUses) {
+				const auto& resource = resources[use->resource];
+				VkExtent2D extent = getImageExtent(use->resource);
+				assert(extent.width == pass.extent.width && extent.height == pass.extent.height &&
+					"Attachments of a pass must have the same extent");
+
+				// barriers do every transition, so the render pass keeps one layout throughout
+				VkImageLayout layout = getAccessInfo(use->access, use->write).layout;
+				VkAttachmentDescription attachment{};
+				attachment.format = resource.desc.format;
+				attachment.samples = resource.desc.samples;
+				attachment.loadOp = use->loadOp;
+				attachment.storeOp = use->storeOp;
+				bool stencil = hasStencil(resource.desc.format);
+				attachment.stencilLoadOp = stencil ? use->loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				attachment.stencilStoreOp = stencil ? use->storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				attachment.initialLayout = layout;
+				attachment.finalLayout = layout;
+				attachments.push_back(attachment);
+
+				pass.attachments.push_back(use->resource);
+				pass.clearValues.push_back(use->clearValue);
+			}
+
+			pass.renderPass = getOrCreateRenderPass(attachments, hasDepth);
+		}
+	}
+
+	VkRenderPass VeRenderGraph::getOrCreateRenderPass(const std::vector<VkAttachmentDescription>& attachments, bool hasDepth) {
+		std::vector<uint32_t> key;
+		key.push_back(hasDepth ? 1 : 0);
+		for (auto& attachment : attachments) {
+			key.push_back(static_cast<uint32_t>(attachment.format));
+			key.push_back(static_cast<uint32_t>(attachment.samples));
+			key.push_back(static_cast<uint32_t>(attachment.loadOp));
+			key.push_back(static_cast<uint32_t>(attachment.storeOp));
+			key.push_back(static_cast<uint32_t>(attachment.stencilLoadOp));
+			key.push_back(static_cast<uint32_t>(attachment.stencilStoreOp));
+			key.push_back(static_cast<uint32_t>(attachment.initialLayout));
+		}
+		auto it = renderPassCache.find(key);
+		if (it != renderPassCache.end()) {
+			return it->second;
+		}
+
+		uint32_t colorCount = static_cast<uint32_t>(attachments.size()) - (hasDepth ? 1 : 0);
+		std::vector<VkAttachmentReference> colorRefs;
+		for (uint32_t i = 0; i < colorCount; i++) {
+			colorRefs.push_back({ i, attachments[i].initialLayout });
+		}
+		VkAttachmentReference depthRef{ colorCount, hasDepth ? attachments[colorCount].initialLayout : VK_IMAGE_LAYOUT_UNDEFINED };
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = colorCount;
+		subpass.pColorAttachments = colorRefs.data();
+		subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+		VkRenderPassCreateInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkRenderPass renderPass;
+		if (vkCreateRenderPass(veDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph render pass!");
+		}
+		renderPassCache.emplace(std::move(key), renderPass);
+		return renderPass;
+	}
+
+	VkFramebuffer VeRenderGraph::getOrCreateFramebuffer(const Pass& pass) {
+		std::vector<uint64_t> key{ handleKey(pass.renderPass) };
+		std::vector<VkImageView> views;
+		for (auto handle : pass.attachments) {
+			assert(resources[handle].view != VK_NULL_HANDLE && "Imported image was not set for this frame");
+			views.push_back(resources[handle].view);
+			key.push_back(handleKey(resources[handle].view));
+		}
+		auto it = framebufferCache.find(key);
+		if (it != framebufferCache.end()) {
+			return it->second;
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = pass.renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+		framebufferInfo.pAttachments = views.data();
+		framebufferInfo.width = pass.extent.width;
+		framebufferInfo.height = pass.extent.height;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer;
+		if (vkCreateFramebuffer(veDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph framebuffer!");
+		}
+		framebufferCache.emplace(std::move(key), framebuffer);
+		return framebuffer;
+	}
+
+	void VeRenderGraph::destroyFramebuffers() {
+		for (auto& kv : framebufferCache) {
+			vkDestroyFramebuffer(veDevice.device(), kv.second, nullptr);
+		}
+		framebufferCache.clear();
+	}
+
+	void VeRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers) {
+		if (barriers.empty()) return;
+
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+
+		for (auto& barrier : barriers) {
+			srcStages |= barrier.srcStage;
+			dstStages |= barrier.dstStage;
+
+			const auto& resource = resources[barrier.resource];
+			if (resource.type == ResourceType::Buffer) {
+				// a global barrier is as cheap as buffer barriers on current drivers
+				memoryBarrier.srcAccessMask |= barrier.srcAccess;
+				memoryBarrier.dstAccessMask |= barrier.dstAccess;
+				continue;
+			}
+
+			assert(resource.image != VK_NULL_HANDLE && "Imported image was not set for this frame");
+			VkImageMemoryBarrier imageBarrier{};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.oldLayout = barrier.oldLayout;
+			imageBarrier.newLayout = barrier.newLayout;
+			imageBarrier.srcAccessMask = barrier.srcAccess;
+			imageBarrier.dstAccessMask = barrier.dstAccess;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = resource.image;
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+			if (isDepthFormat(resource.desc.format)) {
+				aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil(resource.desc.format) ? static_cast<VkImageAspectFlags>(VK_IMAGE_ASPECT_STENCIL_BIT) : static_cast<VkImageAspectFlags>(0));
+			}
+			imageBarrier.subresourceRange = { aspect, 0, 1, 0, 1 };
+			imageBarriers.push_back(imageBarrier);
+		}
+
+		bool hasMemoryBarrier = memoryBarrier.srcAccessMask != 0 || memoryBarrier.dstAccessMask != 0;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+			dstStages,
+			0,
+			hasMemoryBarrier ? 1 : 0,
+			hasMemoryBarrier ? &memoryBarrier : nullptr,
+			0,
+			nullptr,
+			static_cast<uint32_t>(imageBarriers.size()),
+			imageBarriers.data());
+	}
+
+	void VeRenderGraph::execute(VkCommandBuffer commandBuffer) {
+		assert(compiled && "Render graph must be compiled before execute()");
+
+		for (auto& pass : passes) {
+			if (pass.culled) continue;
+			recordBarriers(commandBuffer, pass.barriers);
+
+			if (!pass.graphics) {
+				pass.execute(commandBuffer);
+				continue;
+			}
+
+			VkRenderPassBeginInfo renderPassInfo{};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassInfo.renderPass = pass.renderPass;
+			renderPassInfo.framebuffer = getOrCreateFramebuffer(pass);
+			renderPassInfo.renderArea.offset = { 0, 0 };
+			renderPassInfo.renderArea.extent = pass.extent;
+			renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+			renderPassInfo.pClearValues = pass.clearValues.data();
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{};
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = static_cast<float>(pass.extent.width);
+			viewport.height = static_cast<float>(pass.extent.height);
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+			VkRect2D scissor{ {0, 0}, pass.extent };
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+			pass.execute(commandBuffer);
+			vkCmdEndRenderPass(commandBuffer);
+		}
+
+		recordBarriers(commandBuffer, finalBarriers);
+	}
+
+} // namespace ve
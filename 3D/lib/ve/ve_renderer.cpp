@@ -7,9 +7,16 @@
 
 namespace ve {
 
-	VeRenderer::VeRenderer(VeWindow& window, VeDevice& device) : veWindow{ window }, veDevice{ device } {
+	VeRenderer::VeRenderer(
+		VeWindow& window,
+		VeDevice& device,
+		VkDeviceSize frameAllocatorSize,
+		const VeSwapChain::Config& swapChainConfig)
+		: veWindow{ window }, veDevice{ device }, swapChainConfig{ swapChainConfig } {
 		recreateSwapChain();
 		createCommandBuffers();
+		gpuProfiler = std::make_unique<VeGpuProfiler>(veDevice);
+		frameAllocator = std::make_unique<VeFrameAllocator>(veDevice, frameAllocatorSize);
 	}
 
 	VeRenderer::~VeRenderer() {
@@ -32,6 +39,9 @@ namespace ve {
 
 		isFrameStarted = true;
 
+		// acquireNextImage waited on this frame's fence, so its previous allocations are no longer read
+		frameAllocator->beginFrame(currentFrameIndex);
+
 		auto commandBuffer = getCurrentCommandBuffer();
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -40,6 +50,9 @@ namespace ve {
 			throw std::runtime_error("failed to begin recording command buffer!");
 		}
 
+		// the fence wait above also made this frame's previous timestamps available
+		gpuProfiler->beginFrame(commandBuffer, currentFrameIndex);
+
 		return commandBuffer;
 	}
 
@@ -63,13 +76,64 @@ namespace ve {
 		currentFrameIndex = (currentFrameIndex + 1) % VeSwapChain::MAX_FRAMES_IN_FLIGHT;
 	}
 
-	void VeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+	void VeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, bool suspendable) {
 		assert(isFrameStarted && "Cannot begin swap chain render pass when frame not in progress.");
 		assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer outside frame.");
+		assert((!suspendable || swapChainConfig.sampledDepth) && "Suspendable render pass needs a sampled depth image.");
+
+		isRenderPassSuspendable = suspendable;
+		isMainSubpassStarted = false;
+
+		if (swapChainConfig.dynamicRendering) {
+			// what the render pass's initial layouts and external dependencies do; the attachments other than
+			// the swap chain image are shared with the previous frame
+			VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			transitionImage(
+				commandBuffer,
+				veSwapChain->getImage(currentImageIndex),
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				0,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+			if (veSwapChain->getColorImage() != VK_NULL_HANDLE) {
+				transitionImage(
+					commandBuffer,
+					veSwapChain->getColorImage(),
+					VK_IMAGE_ASPECT_COLOR_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+			}
+			transitionImage(
+				commandBuffer,
+				veSwapChain->getDepthImage(),
+				getDepthAspectMask(),
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				swapChainConfig.sampledDepth ? depthStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : depthStages,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				depthStages,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+			gpuProfiler->beginScope(commandBuffer, hasDepthPrePass() ? DEPTH_PREPASS_SCOPE : MAIN_PASS_SCOPE);
+
+			beginDynamicRendering(commandBuffer, hasDepthPrePass(), false, false);
+			if (!hasDepthPrePass()) {
+				beginMainSubpass(commandBuffer);
+			}
+			setFullViewport(commandBuffer);
+			return;
+		}
 
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = veSwapChain->getRenderPass();
+		renderPassInfo.renderPass = suspendable ? veSwapChain->getSuspendingRenderPass() : veSwapChain->getRenderPass();
 		renderPassInfo.framebuffer = veSwapChain->getFrameBuffer(currentImageIndex);
 
 		renderPassInfo.renderArea.offset = { 0, 0 };
@@ -81,8 +145,87 @@ namespace ve {
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
+		gpuProfiler->beginScope(commandBuffer, hasDepthPrePass() ? DEPTH_PREPASS_SCOPE : MAIN_PASS_SCOPE);
+
 		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		if (!hasDepthPrePass()) {
+			beginMainSubpass(commandBuffer);
+		}
+		setFullViewport(commandBuffer);
+	}
 
+	void VeRenderer::suspendSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+		assert(isFrameStarted && "Cannot suspend swap chain render pass when frame not in progress.");
+		assert(isRenderPassSuspendable && "Render pass was not begun as suspendable.");
+		assert(isMainSubpassStarted && "Render pass can only be suspended in the main subpass.");
+
+		if (swapChainConfig.dynamicRendering) {
+			veDevice.cmdEndRendering(commandBuffer);
+			transitionImage(
+				commandBuffer,
+				veSwapChain->getDepthImage(),
+				getDepthAspectMask(),
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT);
+		}
+		else {
+			vkCmdEndRenderPass(commandBuffer);
+		}
+		isRenderPassSuspendable = false;
+	}
+
+	void VeRenderer::resumeSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+		assert(isFrameStarted && "Cannot resume swap chain render pass when frame not in progress.");
+		assert(commandBuffer == getCurrentCommandBuffer() && "Can't resume render pass on command buffer outside frame.");
+
+		if (swapChainConfig.dynamicRendering) {
+			transitionImage(
+				commandBuffer,
+				veSwapChain->getDepthImage(),
+				getDepthAspectMask(),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+			transitionImage(
+				commandBuffer,
+				veSwapChain->getImage(currentImageIndex),
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+			// the pre-pass already ran before the suspend, resume straight into the main pass
+			beginDynamicRendering(commandBuffer, false, true, true);
+			setFullViewport(commandBuffer);
+			return;
+		}
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = veSwapChain->getResumingRenderPass();
+		renderPassInfo.framebuffer = veSwapChain->getFrameBuffer(currentImageIndex);
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = veSwapChain->getSwapChainExtent();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		if (hasDepthPrePass()) {
+			// the pre-pass already ran before the suspend, skip straight to the main subpass
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+		}
+		setFullViewport(commandBuffer);
+	}
+
+	void VeRenderer::setFullViewport(VkCommandBuffer commandBuffer) {
 		VkViewport viewport{};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
@@ -95,13 +238,146 @@ namespace ve {
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 	}
 
+	void VeRenderer::beginMainSubpass(VkCommandBuffer commandBuffer) {
+		assert(isFrameStarted && "Cannot begin main subpass when frame not in progress.");
+		if (isMainSubpassStarted) {
+			// without a pre-pass the main subpass starts with the render pass
+			assert(!hasDepthPrePass() && "Main subpass already started.");
+			return;
+		}
+
+		if (hasDepthPrePass() && swapChainConfig.dynamicRendering) {
+			// the subpass dependency between pre-pass and main subpass
+			veDevice.cmdEndRendering(commandBuffer);
+			transitionImage(
+				commandBuffer,
+				veSwapChain->getDepthImage(),
+				getDepthAspectMask(),
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+			beginDynamicRendering(commandBuffer, false, false, true);
+		}
+		else if (hasDepthPrePass()) {
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+		}
+		if (hasDepthPrePass()) {
+			// end of the depth-only work, a timestamp at the start of the next subpass waits for it
+			gpuProfiler->endScope(commandBuffer);
+			gpuProfiler->beginScope(commandBuffer, MAIN_PASS_SCOPE, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		}
+		isMainSubpassStarted = true;
+	}
+
 	void VeRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
 		assert(isFrameStarted && "Cannot begin swap chain render pass when frame not in progress.");
 		assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer outside frame.");
 
+		if (!isMainSubpassStarted) {
+			beginMainSubpass(commandBuffer);
+		}
+		gpuProfiler->endScope(commandBuffer);
+
+		if (swapChainConfig.dynamicRendering) {
+			veDevice.cmdEndRendering(commandBuffer);
+			transitionImage(
+				commandBuffer,
+				veSwapChain->getImage(currentImageIndex),
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0);
+			return;
+		}
 		vkCmdEndRenderPass(commandBuffer);
 	}
 
+	void VeRenderer::beginDynamicRendering(VkCommandBuffer commandBuffer, bool depthOnly, bool loadColor, bool loadDepth) {
+		bool multisampled = veSwapChain->getColorImage() != VK_NULL_HANDLE;
+
+		VkRenderingAttachmentInfo colorAttachment{};
+		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.loadOp = loadColor ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.clearValue.color = { 0.01f, 0.01f, 0.01f, 1.0f };
+		if (multisampled) {
+			colorAttachment.imageView = veSwapChain->getColorImageView();
+			colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+			colorAttachment.resolveImageView = veSwapChain->getImageView(currentImageIndex);
+			colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colorAttachment.storeOp = isRenderPassSuspendable ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+		else {
+			colorAttachment.imageView = veSwapChain->getImageView(currentImageIndex);
+			colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+		}
+
+		// depth outlives the scope only when the main pass or compute work still reads it
+		VkRenderingAttachmentInfo depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.imageView = veSwapChain->getDepthImageView();
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+		depthAttachment.loadOp = loadDepth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment.storeOp = depthOnly || isRenderPassSuspendable ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+		VkRenderingInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = veSwapChain->getSwapChainExtent();
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = depthOnly ? 0 : 1;
+		renderingInfo.pColorAttachments = depthOnly ? nullptr : &colorAttachment;
+		renderingInfo.pDepthAttachment = &depthAttachment;
+
+		veDevice.cmdBeginRendering(commandBuffer, &renderingInfo);
+	}
+
+	VkImageAspectFlags VeRenderer::getDepthAspectMask() const {
+		// layout transitions of combined formats cover both aspects
+		VkFormat format = veSwapChain->getSwapChainDepthFormat();
+		if (format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT) {
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	}
+
+	void VeRenderer::transitionImage(
+		VkCommandBuffer commandBuffer,
+		VkImage image,
+		VkImageAspectFlags aspectMask,
+		VkImageLayout oldLayout,
+		VkImageLayout newLayout,
+		VkPipelineStageFlags srcStage,
+		VkAccessFlags srcAccess,
+		VkPipelineStageFlags dstStage,
+		VkAccessFlags dstAccess) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = aspectMask;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
 	void VeRenderer::recreateSwapChain() {
 		auto extent = veWindow.getExtent();
 		while (extent.width == 0 || extent.height == 0) {
@@ -112,16 +388,17 @@ namespace ve {
 		vkDeviceWaitIdle(veDevice.device());
 
 		if (veSwapChain == nullptr) {
-			veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent);
+			veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent, swapChainConfig);
 		}
 		else {
 			std::shared_ptr<VeSwapChain> oldSwapChain = std::move(veSwapChain);
-			veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent, oldSwapChain);
+			veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent, oldSwapChain, swapChainConfig);
 
 			if (!oldSwapChain->compareSwapFormats(*veSwapChain.get())) {
 				throw std::runtime_error("Swap chain image (or depth) format has changed!");
 			}
 		}
+		swapChainGeneration++;
 
 	}
 
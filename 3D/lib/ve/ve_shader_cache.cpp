@@ -0,0 +1,189 @@
+#include "ve/ve_shader_cache.hpp"
+#include "ve/ve_utils.hpp"
+
+// std
+#include <filesystem>
+#include <stdexcept>
+
+// platform
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace ve {
+
+	namespace {
+
+		// Read-only memory mapping of a whole file. Mappings are page aligned, which satisfies the
+		// 4 byte alignment vkCreateShaderModule requires of pCode.
+		class MappedFile {
+		public:
+			explicit MappedFile(const std::string& filepath) {
+#ifdef _WIN32
+				file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file == INVALID_HANDLE_VALUE) {
+					throw std::runtime_error("failed to open file: " + filepath);
+				}
+				LARGE_INTEGER fileSize{};
+				if (!GetFileSizeEx(file, &fileSize)) {
+					close();
+					throw std::runtime_error("failed to stat file: " + filepath);
+				}
+				size = static_cast<size_t>(fileSize.QuadPart);
+				if (size == 0) return;
+
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping != nullptr) {
+					data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				}
+#else
+				fd = open(filepath.c_str(), O_RDONLY);
+				if (fd < 0) {
+					throw std::runtime_error("failed to open file: " + filepath);
+				}
+				struct stat fileStat {};
+				if (fstat(fd, &fileStat) != 0) {
+					close();
+					throw std::runtime_error("failed to stat file: " + filepath);
+				}
+				size = static_cast<size_t>(fileStat.st_size);
+				if (size == 0) return;
+
+				data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data == MAP_FAILED) {
+					data = nullptr;
+				}
+#endif
+				if (data == nullptr) {
+					close();
+					throw std::runtime_error("failed to map file: " + filepath);
+				}
+			}
+
+			~MappedFile() { close(); }
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			const void* getData() const { return data; }
+			size_t getSize() const { return size; }
+
+		private:
+			void close() {
+#ifdef _WIN32
+				if (data != nullptr) UnmapViewOfFile(data);
+				if (mapping != nullptr) CloseHandle(mapping);
+				if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+				mapping = nullptr;
+				file = INVALID_HANDLE_VALUE;
+#else
+				if (data != nullptr) munmap(data, size);
+				if (fd >= 0) ::close(fd);
+				fd = -1;
+#endif
+				data = nullptr;
+			}
+
+#ifdef _WIN32
+			HANDLE file = INVALID_HANDLE_VALUE;
+			HANDLE mapping = nullptr;
+#else
+			int fd = -1;
+#endif
+			void* data = nullptr;
+			size_t size = 0;
+		};
+
+		// 64 bit FNV-1a, cheap enough to run over every SPIR-V blob on load
+		uint64_t hashContent(const void* data, size_t size) {
+			const auto* bytes = static_cast<const uint8_t*>(data);
+			uint64_t hash = 0xcbf29ce484222325ull;
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ull;
+			}
+			return hash;
+		}
+
+	} // namespace
+
+
+	// ******************************	Shader Module		*************************************** //
+	VeShaderModule::VeShaderModule(VeDevice& device, const uint32_t* code, size_t codeSize, uint64_t contentHash)
+		: veDevice{ device }, contentHash{ contentHash } {
+		try {
+			reflection = ShaderReflection::reflect(code, codeSize);
+		}
+		catch (const std::runtime_error& error) {
+			reflectionError = error.what();
+		}
+
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = codeSize;
+		createInfo.pCode = code;
+
+		if (vkCreateShaderModule(veDevice.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shader module!");
+		}
+	}
+
+	VeShaderModule::~VeShaderModule() {
+		vkDestroyShaderModule(veDevice.device(), shaderModule, nullptr);
+	}
+
+	const ShaderReflection& VeShaderModule::getReflection() const {
+		if (!reflection.has_value()) {
+			throw std::runtime_error(reflectionError);
+		}
+		return *reflection;
+	}
+
+
+	// ******************************	Shader Cache		*************************************** //
+	size_t VeShaderCache::KeyHash::operator()(const Key& key) const {
+		size_t seed = 0;
+		hashCombine(seed, key.filepath, key.contentHash);
+		return seed;
+	}
+
+	std::shared_ptr<VeShaderModule> VeShaderCache::getShaderModule(const std::string& filepath) {
+		MappedFile file{ filepath };
+		if (file.getSize() == 0 || file.getSize() % sizeof(uint32_t) != 0) {
+			throw std::runtime_error("invalid SPIR-V file: " + filepath);
+		}
+
+		Key key{ std::filesystem::path(filepath).lexically_normal().string(), hashContent(file.getData(), file.getSize()) };
+
+		std::lock_guard<std::mutex> lock{ cacheMutex };
+
+		auto it = modules.find(key);
+		if (it != modules.end()) {
+			if (auto module = it->second.lock()) {
+				return module;
+			}
+		}
+
+		auto module = std::make_shared<VeShaderModule>(
+			veDevice,
+			static_cast<const uint32_t*>(file.getData()),
+			file.getSize(),
+			key.contentHash);
+
+		// drop entries for modules no pipeline references anymore, e.g. older versions of this file
+		for (auto entry = modules.begin(); entry != modules.end();) {
+			entry = entry->second.expired() ? modules.erase(entry) : std::next(entry);
+		}
+		modules[key] = module;
+		return module;
+	}
+
+} // namespace ve
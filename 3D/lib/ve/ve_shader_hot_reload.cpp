@@ -0,0 +1,339 @@
+#include "ve/ve_shader_hot_reload.hpp"
+#include "ve/ve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+
+// platform
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+namespace ve {
+
+	namespace {
+
+		constexpr auto WATCH_INTERVAL = std::chrono::milliseconds(250);
+
+		// editors tend to save in several writes, give them a moment before compiling
+		constexpr auto SETTLE_DELAY = std::chrono::milliseconds(50);
+
+		std::string normalizePath(const std::string& filepath) {
+			std::error_code error;
+			auto path = std::filesystem::weakly_canonical(filepath, error);
+			return error ? std::filesystem::path(filepath).lexically_normal().string() : path.string();
+		}
+
+		bool isShaderStage(const std::filesystem::path& path) {
+			static const std::set<std::string> stages{ ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+			return stages.count(path.extension().string()) > 0;
+		}
+
+		// shared code pulled in through #include, a change to it recompiles the stages including it
+		bool isShaderInclude(const std::filesystem::path& path) {
+			return path.extension() == ".glsl";
+		}
+
+		// prerequisites of a make style depfile as written by glslc -MD, matches read_depfile in
+		// tools/compile_shaders.py; a backslash only escapes a space, '#' or another backslash so Windows
+		// paths keep their separators
+		bool readDepfile(const std::string& filepath, std::vector<std::string>& deps) {
+			std::ifstream file{ filepath };
+			if (!file.is_open()) {
+				return false;
+			}
+			std::string content{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+			size_t start = content.find(": ");
+			if (start == std::string::npos) {
+				return false;
+			}
+
+			std::string current;
+			for (size_t i = start + 2; i < content.size(); i++) {
+				char ch = content[i];
+				char next = i + 1 < content.size() ? content[i + 1] : '\0';
+				if (ch == '\\' && (next == '\n' || next == '\r')) {
+					continue;
+				}
+				if (ch == '\\' && (next == ' ' || next == '#' || next == '\\')) {
+					current += next;
+					i++;
+				} else if (std::isspace(static_cast<unsigned char>(ch))) {
+					if (!current.empty()) deps.push_back(current);
+					current.clear();
+				} else {
+					current += ch;
+				}
+			}
+			if (!current.empty()) deps.push_back(current);
+			return true;
+		}
+
+	} // namespace
+
+
+	// ******************************	Reloadable Pipeline	*************************************** //
+	VeReloadablePipeline::VeReloadablePipeline(
+		const std::string& vertFilepath,
+		const std::string& fragFilepath,
+		const PipelineConfigInfo& configInfo)
+		: vertFilepath{ vertFilepath }, fragFilepath{ fragFilepath }, configInfo{ configInfo } {}
+
+	bool VeReloadablePipeline::bind(VkCommandBuffer commandBuffer) {
+		return hasUsablePipeline() && current->bind(commandBuffer);
+	}
+
+	VePipeline* VeReloadablePipeline::get() {
+		return hasUsablePipeline() ? current->get() : nullptr;
+	}
+
+	bool VeReloadablePipeline::hasUsablePipeline() {
+		if (current == nullptr) {
+			return false;
+		}
+		try {
+			current->isReady();
+		} catch (const std::exception& e) {
+			std::cerr << "failed to compile pipeline " << vertFilepath << ", " << fragFilepath << ": "
+				<< e.what() << std::endl;
+			current.reset();
+			return false;
+		}
+		return true;
+	}
+
+	bool VeReloadablePipeline::usesShader(const std::string& spvFilepath) const {
+		return normalizePath(vertFilepath) == spvFilepath || normalizePath(fragFilepath) == spvFilepath;
+	}
+
+
+	// ******************************	Shader Hot Reloader	*************************************** //
+	VeShaderHotReloader::VeShaderHotReloader(
+		VePipelineCompiler& compiler,
+		const std::string& shaderDirectory,
+		const std::string& glslcPath,
+		VePipelineCache* pipelineCache)
+		: veCompiler{ compiler },
+		vePipelineCache{ pipelineCache },
+		shaderDirectory{ shaderDirectory },
+		glslcPath{ glslcPath } {
+		watcher = std::thread([this]() { watchLoop(); });
+	}
+
+	VeShaderHotReloader::~VeShaderHotReloader() {
+		stopping = true;
+		watcher.join();
+	}
+
+	std::shared_ptr<VeReloadablePipeline> VeShaderHotReloader::createPipeline(
+		const std::string& vertFilepath,
+		const std::string& fragFilepath,
+		const PipelineConfigInfo& configInfo) {
+		auto pipeline = std::make_shared<VeReloadablePipeline>(vertFilepath, fragFilepath, configInfo);
+		pipeline->current = veCompiler.compile(vertFilepath, fragFilepath, configInfo);
+		pipelines.push_back(pipeline);
+		return pipeline;
+	}
+
+	void VeShaderHotReloader::update() {
+		frameCounter++;
+
+		std::vector<std::string> changed;
+		{
+			std::lock_guard<std::mutex> lock{ compiledMutex };
+			changed.swap(compiledShaders);
+		}
+
+		pipelines.erase(
+			std::remove_if(pipelines.begin(), pipelines.end(), [](auto& pipeline) { return pipeline.expired(); }),
+			pipelines.end());
+
+		for (auto& spvFilepath : changed) {
+			if (vePipelineCache != nullptr) {
+				vePipelineCache->invalidate(spvFilepath);
+			}
+			for (auto& weakPipeline : pipelines) {
+				auto pipeline = weakPipeline.lock();
+				if (pipeline->usesShader(spvFilepath)) {
+					// a newer compile supersedes one still in flight, its result is simply dropped
+					pipeline->pending = veCompiler.compile(pipeline->vertFilepath, pipeline->fragFilepath, pipeline->configInfo);
+				}
+			}
+		}
+
+		for (auto& weakPipeline : pipelines) {
+			auto pipeline = weakPipeline.lock();
+			if (pipeline->pending == nullptr) {
+				continue;
+			}
+
+			try {
+				if (!pipeline->pending->isReady()) {
+					continue;
+				}
+			} catch (const std::exception& e) {
+				// keep rendering with the last good pipeline until the shader is fixed
+				std::cerr << "failed to reload pipeline " << pipeline->vertFilepath << ", "
+					<< pipeline->fragFilepath << ": " << e.what() << std::endl;
+				pipeline->pending.reset();
+				continue;
+			}
+
+			if (pipeline->current != nullptr) {
+				retiredPipelines.push_back({ pipeline->current, frameCounter + VeSwapChain::MAX_FRAMES_IN_FLIGHT });
+			}
+			pipeline->current = std::move(pipeline->pending);
+		}
+
+		while (!retiredPipelines.empty() && retiredPipelines.front().releaseFrame <= frameCounter) {
+			retiredPipelines.pop_front();
+		}
+	}
+
+	void VeShaderHotReloader::handleChangedSources(const std::vector<std::string>& sources) {
+		std::set<std::string> toCompile;
+		for (auto& source : sources) {
+			std::filesystem::path path{ source };
+			if (isShaderStage(path)) {
+				toCompile.insert(path.string());
+			} else if (isShaderInclude(path)) {
+				std::error_code error;
+				for (auto& entry : std::filesystem::directory_iterator(shaderDirectory, error)) {
+					if (isShaderStage(entry.path()) && dependsOn(entry.path().string(), path.string())) {
+						toCompile.insert(entry.path().string());
+					}
+				}
+			}
+		}
+
+		for (auto& source : toCompile) {
+			if (compileShader(source)) {
+				std::lock_guard<std::mutex> lock{ compiledMutex };
+				compiledShaders.push_back(normalizePath(source + ".spv"));
+			}
+		}
+	}
+
+	bool VeShaderHotReloader::dependsOn(const std::string& sourceFilepath, const std::string& includeFilepath) const {
+		// without a depfile there is no telling, so the stage is recompiled
+		std::vector<std::string> deps;
+		if (!readDepfile(sourceFilepath + ".spv.d", deps)) {
+			return true;
+		}
+		const std::string include = normalizePath(includeFilepath);
+		return std::any_of(deps.begin(), deps.end(), [&](auto& dep) { return normalizePath(dep) == include; });
+	}
+
+	bool VeShaderHotReloader::compileShader(const std::string& sourceFilepath) {
+		// compile next to the target and rename over it, so pipelines never map a half written file
+		const std::string spvFilepath = sourceFilepath + ".spv";
+		const std::string tempFilepath = spvFilepath + ".tmp";
+		const std::string command = "\"" + glslcPath + "\" \"" + sourceFilepath + "\" -o \"" + tempFilepath +
+			"\" -I \"" + shaderDirectory + "\" -MD -MF \"" + spvFilepath + ".d\" -MT \"" + spvFilepath + "\"";
+
+		std::error_code error;
+		if (std::system(command.c_str()) != 0) {
+			std::cerr << "failed to compile shader: " << sourceFilepath << std::endl;
+			std::filesystem::remove(tempFilepath, error);
+			return false;
+		}
+
+		std::filesystem::rename(tempFilepath, spvFilepath, error);
+		if (error) {
+			std::cerr << "failed to replace shader: " << spvFilepath << std::endl;
+			std::filesystem::remove(tempFilepath, error);
+			return false;
+		}
+
+		// the reflection metadata no longer matches, compile_shaders.py regenerates it once it is gone
+		std::filesystem::remove(spvFilepath + ".json", error);
+
+		std::cout << "reloaded shader: " << sourceFilepath << std::endl;
+		return true;
+	}
+
+	void VeShaderHotReloader::watchLoop() {
+#ifdef __linux__
+		int fd = inotify_init1(IN_NONBLOCK);
+		if (fd < 0 || inotify_add_watch(fd, shaderDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			std::cerr << "inotify unavailable, polling shader directory: " << shaderDirectory << std::endl;
+			if (fd >= 0) close(fd);
+			watchLoopPolling();
+			return;
+		}
+
+		alignas(inotify_event) char buffer[4096];
+		while (!stopping) {
+			pollfd pollInfo{ fd, POLLIN, 0 };
+			if (poll(&pollInfo, 1, static_cast<int>(WATCH_INTERVAL.count())) <= 0) {
+				continue;
+			}
+
+			std::this_thread::sleep_for(SETTLE_DELAY);
+
+			std::vector<std::string> changed;
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+				for (char* ptr = buffer; ptr < buffer + length;) {
+					auto* event = reinterpret_cast<inotify_event*>(ptr);
+					if (event->len > 0) {
+						changed.push_back((std::filesystem::path(shaderDirectory) / event->name).string());
+					}
+					ptr += sizeof(inotify_event) + event->len;
+				}
+			}
+			handleChangedSources(changed);
+		}
+		close(fd);
+#else
+		watchLoopPolling();
+#endif
+	}
+
+	void VeShaderHotReloader::watchLoopPolling() {
+		auto snapshot = [this]() {
+			std::map<std::string, std::filesystem::file_time_type> times;
+			std::error_code error;
+			for (auto& entry : std::filesystem::directory_iterator(shaderDirectory, error)) {
+				if (isShaderStage(entry.path()) || isShaderInclude(entry.path())) {
+					times[entry.path().string()] = entry.last_write_time(error);
+				}
+			}
+			return times;
+		};
+
+		auto previous = snapshot();
+		while (!stopping) {
+			std::this_thread::sleep_for(WATCH_INTERVAL);
+
+			auto current = snapshot();
+			std::vector<std::string> changed;
+			for (auto& [path, time] : current) {
+				auto it = previous.find(path);
+				if (it == previous.end() || it->second != time) {
+					changed.push_back(path);
+				}
+			}
+
+			if (!changed.empty()) {
+				std::this_thread::sleep_for(SETTLE_DELAY);
+				handleChangedSources(changed);
+			}
+			previous = std::move(current);
+		}
+	}
+
+} // namespace ve
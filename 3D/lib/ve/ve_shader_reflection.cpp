@@ -0,0 +1,374 @@
+#include "ve/ve_shader_reflection.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace ve {
+
+	namespace {
+
+		// subset of the SPIR-V spec needed to walk a module's interface
+		constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+		constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+		enum Op : uint32_t {
+			OpEntryPoint = 15,
+			OpTypeInt = 21,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeMatrix = 24,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstant = 43,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72,
+			OpTypeAccelerationStructureKHR = 5341,
+		};
+
+		enum Decoration : uint32_t {
+			DecorationBufferBlock = 3,
+			DecorationArrayStride = 6,
+			DecorationMatrixStride = 7,
+			DecorationBuiltIn = 11,
+			DecorationLocation = 30,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35,
+		};
+
+		enum StorageClass : uint32_t {
+			StorageClassUniformConstant = 0,
+			StorageClassInput = 1,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12,
+		};
+
+		constexpr uint32_t DimBuffer = 5;
+		constexpr uint32_t DimSubpassData = 6;
+
+		struct Type {
+			uint32_t op = 0;
+			std::vector<uint32_t> operands;
+		};
+
+		struct Variable {
+			uint32_t id;
+			uint32_t pointerType;
+			uint32_t storageClass;
+		};
+
+		class SpirvModule {
+		public:
+			SpirvModule(const uint32_t* code, size_t wordCount) {
+				if (wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+					throw std::runtime_error("failed to reflect shader, not a SPIR-V module!");
+				}
+
+				size_t i = SPIRV_HEADER_WORDS;
+				while (i < wordCount) {
+					uint32_t length = code[i] >> 16;
+					uint32_t op = code[i] & 0xFFFF;
+					if (length == 0 || i + length > wordCount) {
+						throw std::runtime_error("failed to reflect shader, malformed SPIR-V!");
+					}
+					parse(op, code + i + 1, length - 1);
+					i += length;
+				}
+			}
+
+			VkShaderStageFlagBits stage{ VK_SHADER_STAGE_VERTEX_BIT };
+			std::unordered_map<uint32_t, Type> types;
+			std::unordered_map<uint32_t, uint32_t> constants;
+			std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> decorations;
+			std::unordered_map<uint64_t, std::unordered_map<uint32_t, uint32_t>> memberDecorations;
+			std::vector<Variable> variables;
+
+			bool hasDecoration(uint32_t id, uint32_t decoration) const {
+				auto it = decorations.find(id);
+				return it != decorations.end() && it->second.count(decoration) > 0;
+			}
+
+			uint32_t decoration(uint32_t id, uint32_t decoration, uint32_t fallback = 0) const {
+				auto it = decorations.find(id);
+				if (it == decorations.end()) return fallback;
+				auto value = it->second.find(decoration);
+				return value != it->second.end() ? value->second : fallback;
+			}
+
+			uint32_t memberDecoration(uint32_t id, uint32_t member, uint32_t decoration, uint32_t fallback = 0) const {
+				auto it = memberDecorations.find(memberKey(id, member));
+				if (it == memberDecorations.end()) return fallback;
+				auto value = it->second.find(decoration);
+				return value != it->second.end() ? value->second : fallback;
+			}
+
+			const Type& type(uint32_t id) const {
+				auto it = types.find(id);
+				if (it == types.end()) {
+					throw std::runtime_error("failed to reflect shader, unknown type id!");
+				}
+				return it->second;
+			}
+
+			// byte size of a type laid out with explicit offsets/strides, as push constant blocks are
+			uint32_t sizeOf(uint32_t id) const {
+				const Type& t = type(id);
+				switch (t.op) {
+				case OpTypeInt:
+				case OpTypeFloat:
+					return t.operands[0] / 8;
+				case OpTypeVector:
+				case OpTypeMatrix:
+					return sizeOf(t.operands[0]) * t.operands[1];
+				case OpTypeArray: {
+					uint32_t stride = decoration(id, DecorationArrayStride, sizeOf(t.operands[0]));
+					return stride * constants.at(t.operands[1]);
+				}
+				case OpTypeStruct: {
+					uint32_t size = 0;
+					for (uint32_t member = 0; member < t.operands.size(); member++) {
+						uint32_t memberType = t.operands[member];
+						uint32_t memberSize = sizeOf(memberType);
+						uint32_t matrixStride = memberDecoration(id, member, DecorationMatrixStride);
+						if (matrixStride != 0 && type(memberType).op == OpTypeMatrix) {
+							memberSize = matrixStride * type(memberType).operands[1];
+						}
+						size = std::max(size, memberDecoration(id, member, DecorationOffset) + memberSize);
+					}
+					return size;
+				}
+				default:
+					return 0;
+				}
+			}
+
+		private:
+			static uint64_t memberKey(uint32_t id, uint32_t member) {
+				return (static_cast<uint64_t>(id) << 32) | member;
+			}
+
+			void parse(uint32_t op, const uint32_t* operands, uint32_t count) {
+				switch (op) {
+				case OpEntryPoint:
+					stage = toStage(operands[0]);
+					break;
+				case OpTypeInt:
+				case OpTypeFloat:
+				case OpTypeVector:
+				case OpTypeMatrix:
+				case OpTypeImage:
+				case OpTypeSampler:
+				case OpTypeSampledImage:
+				case OpTypeArray:
+				case OpTypeRuntimeArray:
+				case OpTypeStruct:
+				case OpTypePointer:
+				case OpTypeAccelerationStructureKHR:
+					types[operands[0]] = Type{ op, std::vector<uint32_t>(operands + 1, operands + count) };
+					break;
+				case OpConstant:
+					constants[operands[1]] = operands[2];
+					break;
+				case OpVariable:
+					variables.push_back({ operands[1], operands[0], operands[2] });
+					break;
+				case OpDecorate:
+					decorations[operands[0]][operands[1]] = count > 2 ? operands[2] : 1;
+					break;
+				case OpMemberDecorate:
+					memberDecorations[memberKey(operands[0], operands[1])][operands[2]] = count > 3 ? operands[3] : 1;
+					break;
+				default:
+					break;
+				}
+			}
+
+			static VkShaderStageFlagBits toStage(uint32_t executionModel) {
+				switch (executionModel) {
+				case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+				case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+				case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+				case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+				case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+				case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+				default:
+					throw std::runtime_error("failed to reflect shader, unsupported execution model!");
+				}
+			}
+		};
+
+		VkDescriptorType descriptorType(const SpirvModule& module, uint32_t typeId, uint32_t storageClass) {
+			const Type& t = module.type(typeId);
+			if (storageClass == StorageClassStorageBuffer || module.hasDecoration(typeId, DecorationBufferBlock)) {
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			if (storageClass == StorageClassUniform) {
+				return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			}
+
+			switch (t.op) {
+			case OpTypeSampler:
+				return VK_DESCRIPTOR_TYPE_SAMPLER;
+			case OpTypeSampledImage:
+				return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			case OpTypeImage: {
+				uint32_t dim = t.operands[1];
+				uint32_t sampled = t.operands[5];
+				if (dim == DimSubpassData) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				if (dim == DimBuffer) {
+					return sampled == 1 ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+				}
+				return sampled == 1 ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			}
+			case OpTypeAccelerationStructureKHR:
+				return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+			default:
+				throw std::runtime_error("failed to reflect shader, unsupported descriptor type!");
+			}
+		}
+
+		VkFormat vertexFormat(uint32_t op, uint32_t width, bool isSigned, uint32_t components) {
+			static constexpr VkFormat floatFormats[3][4] = {
+				{ VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT },
+				{ VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT },
+				{ VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT } };
+			static constexpr VkFormat sintFormats[3][4] = {
+				{ VK_FORMAT_R16_SINT, VK_FORMAT_R16G16_SINT, VK_FORMAT_R16G16B16_SINT, VK_FORMAT_R16G16B16A16_SINT },
+				{ VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT },
+				{ VK_FORMAT_R64_SINT, VK_FORMAT_R64G64_SINT, VK_FORMAT_R64G64B64_SINT, VK_FORMAT_R64G64B64A64_SINT } };
+			static constexpr VkFormat uintFormats[3][4] = {
+				{ VK_FORMAT_R16_UINT, VK_FORMAT_R16G16_UINT, VK_FORMAT_R16G16B16_UINT, VK_FORMAT_R16G16B16A16_UINT },
+				{ VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT },
+				{ VK_FORMAT_R64_UINT, VK_FORMAT_R64G64_UINT, VK_FORMAT_R64G64B64_UINT, VK_FORMAT_R64G64B64A64_UINT } };
+
+			uint32_t widthIndex = width == 16 ? 0 : width == 32 ? 1 : 2;
+			if (op == OpTypeFloat) return floatFormats[widthIndex][components - 1];
+			return isSigned ? sintFormats[widthIndex][components - 1] : uintFormats[widthIndex][components - 1];
+		}
+
+		// one input per location: matrices take a location per column and arrays one per element, and
+		// 64 bit vectors of more than two components span two locations
+		void addVertexInputs(
+			const SpirvModule& module,
+			uint32_t typeId,
+			uint32_t location,
+			std::vector<ShaderReflection::VertexInput>& inputs) {
+			const Type* t = &module.type(typeId);
+			uint32_t elements = 1;
+			if (t->op == OpTypeArray) {
+				elements = module.constants.at(t->operands[1]);
+				t = &module.type(t->operands[0]);
+			}
+			uint32_t columns = 1;
+			if (t->op == OpTypeMatrix) {
+				columns = t->operands[1];
+				t = &module.type(t->operands[0]);
+			}
+			uint32_t components = 1;
+			if (t->op == OpTypeVector) {
+				components = t->operands[1];
+				t = &module.type(t->operands[0]);
+			}
+
+			uint32_t width = (t->op == OpTypeFloat || t->op == OpTypeInt) ? t->operands[0] : 0;
+			if ((width != 16 && width != 32 && width != 64) || components > 4) {
+				throw std::runtime_error("failed to reflect shader, unsupported vertex input type!");
+			}
+			bool isSigned = t->op == OpTypeInt && t->operands[1] != 0;
+
+			ShaderReflection::VertexInput input{};
+			input.format = vertexFormat(t->op, width, isSigned, components);
+			input.size = width / 8 * components;
+			uint32_t locationsPerColumn = width == 64 && components > 2 ? 2 : 1;
+			for (uint32_t i = 0; i < elements * columns; i++) {
+				input.location = location;
+				inputs.push_back(input);
+				location += locationsPerColumn;
+			}
+		}
+
+	} // namespace
+
+
+	ShaderReflection ShaderReflection::reflect(const uint32_t* code, size_t codeSize) {
+		SpirvModule module{ code, codeSize / sizeof(uint32_t) };
+
+		ShaderReflection reflection{};
+		reflection.stage = module.stage;
+
+		for (auto& variable : module.variables) {
+			uint32_t typeId = module.type(variable.pointerType).operands[1];
+
+			switch (variable.storageClass) {
+			case StorageClassInput: {
+				if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT ||
+					module.hasDecoration(variable.id, DecorationBuiltIn) ||
+					!module.hasDecoration(variable.id, DecorationLocation)) {
+					break;
+				}
+				addVertexInputs(
+					module, typeId, module.decoration(variable.id, DecorationLocation), reflection.vertexInputs);
+				break;
+			}
+			case StorageClassPushConstant: {
+				const Type& block = module.type(typeId);
+				uint32_t offset = UINT32_MAX;
+				for (uint32_t member = 0; member < block.operands.size(); member++) {
+					offset = std::min(offset, module.memberDecoration(typeId, member, DecorationOffset));
+				}
+				offset = block.operands.empty() ? 0 : offset;
+				reflection.pushConstantRange = VkPushConstantRange{
+					static_cast<VkShaderStageFlags>(reflection.stage),
+					offset,
+					module.sizeOf(typeId) - offset };
+				break;
+			}
+			case StorageClassUniformConstant:
+			case StorageClassUniform:
+			case StorageClassStorageBuffer: {
+				if (!module.hasDecoration(variable.id, DecorationBinding)) {
+					break;
+				}
+
+				uint32_t count = 1;
+				const Type& t = module.type(typeId);
+				if (t.op == OpTypeArray) {
+					count = module.constants.at(t.operands[1]);
+					typeId = t.operands[0];
+				} else if (t.op == OpTypeRuntimeArray) {
+					// unsized, the real count is the caller's (e.g. a bindless table), see the header
+					count = RUNTIME_ARRAY_DESCRIPTOR_COUNT;
+					typeId = t.operands[0];
+				}
+
+				VkDescriptorSetLayoutBinding binding{};
+				binding.binding = module.decoration(variable.id, DecorationBinding);
+				binding.descriptorType = descriptorType(module, typeId, variable.storageClass);
+				binding.descriptorCount = count;
+				binding.stageFlags = reflection.stage;
+
+				uint32_t set = module.decoration(variable.id, DecorationDescriptorSet);
+				reflection.descriptorSets[set][binding.binding] = binding;
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+			[](const VertexInput& a, const VertexInput& b) { return a.location < b.location; });
+		return reflection;
+	}
+
+} // namespace ve
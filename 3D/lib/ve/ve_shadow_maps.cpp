@@ -0,0 +1,361 @@
+#include "ve/ve_shadow_maps.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace ve {
+
+	VeShadowMaps::VeShadowMaps(VeDevice& device, const Config& config)
+		: veDevice{ device }, config{ config } {
+		assert(config.cascadeCount > 0 && config.cascadeCount <= CascadeShadowData::MAX_CASCADES && "Unsupported cascade count");
+
+		// cascades tile the atlas in a square grid
+		uint32_t gridSize = config.cascadeCount == 1 ? 1 : 2;
+		cascadeResolution = config.atlasSize / gridSize;
+		for (uint32_t i = 0; i < config.cascadeCount; i++) {
+			cascades[i].region.offset = {
+				static_cast<int32_t>((i % gridSize) * cascadeResolution),
+				static_cast<int32_t>((i / gridSize) * cascadeResolution) };
+			cascades[i].region.extent = { cascadeResolution, cascadeResolution };
+		}
+
+		createAtlas();
+		createRenderPass();
+		createFramebuffer();
+		createSampler();
+	}
+
+	VeShadowMaps::~VeShadowMaps() {
+		vkDestroySampler(veDevice.device(), sampler, nullptr);
+		vkDestroyFramebuffer(veDevice.device(), framebuffer, nullptr);
+		vkDestroyRenderPass(veDevice.device(), renderPass, nullptr);
+		vkDestroyImageView(veDevice.device(), imageView, nullptr);
+		vkDestroyImage(veDevice.device(), image, nullptr);
+		vkFreeMemory(veDevice.device(), imageMemory, nullptr);
+	}
+
+	void VeShadowMaps::createAtlas() {
+		depthFormat = veDevice.findSupportedFormat(
+			{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM },
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = config.atlasSize;
+		imageInfo.extent.height = config.atlasSize;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = depthFormat;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.flags = 0;
+
+		veDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = depthFormat;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(veDevice.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow atlas image view!");
+		}
+
+		// the render pass loads and stores the atlas in SHADER_READ_ONLY_OPTIMAL so cached cascades survive,
+		// start the image out in that layout
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = viewInfo.subresourceRange;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkCommandBuffer commandBuffer = veDevice.beginSingleTimeCommands();
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+		veDevice.endSingleTimeCommands(commandBuffer);
+	}
+
+	void VeShadowMaps::createRenderPass() {
+		VkAttachmentDescription depthAttachment{};
+		depthAttachment.format = depthFormat;
+		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference depthAttachmentRef{};
+		depthAttachmentRef.attachment = 0;
+		depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 0;
+		subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+		// the previous frame's lighting pass must be done sampling before cascades are overwritten,
+		// and this frame's lighting pass must wait for the new depth
+		std::array<VkSubpassDependency, 2> dependencies{};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &depthAttachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
+
+		if (vkCreateRenderPass(veDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow render pass!");
+		}
+	}
+
+	void VeShadowMaps::createFramebuffer() {
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &imageView;
+		framebufferInfo.width = config.atlasSize;
+		framebufferInfo.height = config.atlasSize;
+		framebufferInfo.layers = 1;
+
+		if (vkCreateFramebuffer(veDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow framebuffer!");
+		}
+	}
+
+	void VeShadowMaps::createSampler() {
+		// comparison sampler for sampler2DShadow, linear filtering gives 2x2 PCF in hardware
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.compareEnable = VK_TRUE;
+		samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		samplerInfo.minLod = 0.f;
+		samplerInfo.maxLod = 0.f;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+		if (vkCreateSampler(veDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow sampler!");
+		}
+	}
+
+	void VeShadowMaps::update(const VeCamera& camera, const glm::vec3& lightDirection) {
+		const glm::mat4& projection = camera.getProjection();
+		assert(projection[2][3] == 1.f && "Cascade fitting needs a perspective projection");
+
+		glm::vec3 direction = glm::normalize(lightDirection);
+		if (direction != this->lightDirection) {
+			this->lightDirection = direction;
+			invalidateCachedCascades();
+		}
+
+		// near and far planes recovered from VeCamera::setPerspectiveProjection's matrix
+		const float nearPlane = -projection[3][2] / projection[2][2];
+		float farPlane = projection[3][2] / (1.f - projection[2][2]);
+		if (config.maxShadowDistance > 0.f) {
+			farPlane = std::min(farPlane, config.maxShadowDistance);
+		}
+
+		const glm::mat4 inverseViewProjection = glm::inverse(projection * camera.getView());
+		auto ndcDepth = [&](float viewDepth) { return projection[2][2] + projection[3][2] / viewDepth; };
+
+		// the light's orientation without translation, for snapping cascade centers to texels
+		glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3{ 0.f, 0.f, 1.f } : glm::vec3{ 0.f, -1.f, 0.f };
+		VeCamera lightCamera{};
+		lightCamera.setViewDirection(glm::vec3{ 0.f }, direction, up);
+		const glm::mat4 lightRotation = lightCamera.getView();
+		const glm::mat4 inverseLightRotation = glm::inverse(lightRotation);
+
+		float splitNear = nearPlane;
+		for (uint32_t i = 0; i < config.cascadeCount; i++) {
+			float p = static_cast<float>(i + 1) / config.cascadeCount;
+			float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+			float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+			float splitFar = config.splitLambda * logSplit + (1.f - config.splitLambda) * uniformSplit;
+
+			glm::vec3 corners[8];
+			glm::vec3 center{ 0.f };
+			for (uint32_t c = 0; c < 8; c++) {
+				glm::vec4 ndc{ (c & 1) ? 1.f : -1.f, (c & 2) ? 1.f : -1.f, ndcDepth((c & 4) ? splitFar : splitNear), 1.f };
+				glm::vec4 world = inverseViewProjection * ndc;
+				corners[c] = glm::vec3(world) / world.w;
+				center += corners[c] / 8.f;
+			}
+
+			// a bounding sphere keeps the cascade size constant while the camera rotates
+			float radius = 0.f;
+			for (auto& corner : corners) {
+				radius = std::max(radius, glm::length(corner - center));
+			}
+			radius = std::ceil(radius * 16.f) / 16.f;
+
+			// moving the center in whole texels stops shadow edges shimmering as the camera moves
+			float texelSize = 2.f * radius / cascadeResolution;
+			glm::vec4 lightSpaceCenter = lightRotation * glm::vec4(center, 1.f);
+			lightSpaceCenter.x = std::floor(lightSpaceCenter.x / texelSize) * texelSize;
+			lightSpaceCenter.y = std::floor(lightSpaceCenter.y / texelSize) * texelSize;
+			// depth is snapped too, or the cached cascades re-render whenever the camera moves along the light;
+			// the snapped center only moves towards the light, so the far plane is pushed out by one step
+			float depthStep = 0.5f * config.casterPadding;
+			if (depthStep > 0.f) {
+				lightSpaceCenter.z = std::floor(lightSpaceCenter.z / depthStep) * depthStep;
+			}
+			center = glm::vec3(inverseLightRotation * lightSpaceCenter);
+
+			Cascade& cascade = cascades[i];
+			cascade.radius = radius;
+			cascade.depthRange = 2.f * radius + config.casterPadding + depthStep;
+			lightCamera.setViewDirection(center - direction * (radius + config.casterPadding), direction, up);
+			lightCamera.setOrthographicProjection(-radius, radius, -radius, radius, 0.f, cascade.depthRange);
+			cascade.view = lightCamera.getView();
+			cascade.viewProjection = lightCamera.getProjection() * lightCamera.getView();
+
+			// ndc xy to the cascade's atlas tile
+			float scale = static_cast<float>(cascadeResolution) / config.atlasSize;
+			glm::mat4 atlasTransform{ 1.f };
+			atlasTransform[0][0] = 0.5f * scale;
+			atlasTransform[1][1] = 0.5f * scale;
+			atlasTransform[3][0] = static_cast<float>(cascade.region.offset.x) / config.atlasSize + 0.5f * scale;
+			atlasTransform[3][1] = static_cast<float>(cascade.region.offset.y) / config.atlasSize + 0.5f * scale;
+			shadowData.worldToShadow[i] = atlasTransform * cascade.viewProjection;
+
+			// inset by a texel so the filter taps never read a neighbouring tile
+			float tileX = static_cast<float>(cascade.region.offset.x) / config.atlasSize;
+			float tileY = static_cast<float>(cascade.region.offset.y) / config.atlasSize;
+			float inset = 1.f / config.atlasSize;
+			shadowData.tileBounds[i] = { tileX + inset, tileY + inset, tileX + scale - inset, tileY + scale - inset };
+			shadowData.splitDepths[i] = splitFar;
+
+			splitNear = splitFar;
+		}
+		shadowData.params = { static_cast<float>(config.cascadeCount), 1.f / config.atlasSize, 0.f, 0.f };
+	}
+
+	void VeShadowMaps::invalidateCachedCascades() {
+		for (auto& cascade : cascades) {
+			cascade.rendered = false;
+		}
+	}
+
+	bool VeShadowMaps::needsRender(uint32_t cascade) const {
+		assert(cascade < config.cascadeCount && "Cascade index out of range");
+		const Cascade& c = cascades[cascade];
+		return !isCascadeCached(cascade) || !c.rendered || c.renderedViewProjection != c.viewProjection;
+	}
+
+	bool VeShadowMaps::isCasterVisible(uint32_t cascade, const glm::vec3& center, float radius) const {
+		const Cascade& c = cascades[cascade];
+		glm::vec4 p = c.view * glm::vec4(center, 1.f);
+		float extent = c.radius + radius;
+		return std::abs(p.x) <= extent && std::abs(p.y) <= extent &&
+			p.z + radius >= 0.f && p.z - radius <= c.depthRange;
+	}
+
+	void VeShadowMaps::beginRenderPass(VkCommandBuffer commandBuffer) {
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = { config.atlasSize, config.atlasSize };
+		renderPassInfo.clearValueCount = 0;
+		renderPassInfo.pClearValues = nullptr;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	void VeShadowMaps::beginCascade(VkCommandBuffer commandBuffer, uint32_t cascade) {
+		assert(cascade < config.cascadeCount && "Cascade index out of range");
+		Cascade& c = cascades[cascade];
+
+		VkViewport viewport{};
+		viewport.x = static_cast<float>(c.region.offset.x);
+		viewport.y = static_cast<float>(c.region.offset.y);
+		viewport.width = static_cast<float>(c.region.extent.width);
+		viewport.height = static_cast<float>(c.region.extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &c.region);
+
+		// only this tile is cleared, cached cascades elsewhere in the atlas are loaded untouched
+		VkClearAttachment clearAttachment{};
+		clearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		clearAttachment.clearValue.depthStencil = { 1.0f, 0 };
+		VkClearRect clearRect{};
+		clearRect.rect = c.region;
+		clearRect.baseArrayLayer = 0;
+		clearRect.layerCount = 1;
+		vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+
+		c.renderedViewProjection = c.viewProjection;
+		c.rendered = true;
+	}
+
+	void VeShadowMaps::endRenderPass(VkCommandBuffer commandBuffer) {
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void VeShadowMaps::configurePipeline(PipelineConfigInfo& configInfo) const {
+		VePipeline::defaultPipelineConfigInfo(configInfo);
+
+		configInfo.colorBlendInfo.attachmentCount = 0;
+		configInfo.colorBlendInfo.pAttachments = nullptr;
+
+		// slope scaled bias against acne, no culling so thin geometry still casts
+		configInfo.rasterizationInfo.depthBiasEnable = VK_TRUE;
+		configInfo.rasterizationInfo.depthBiasConstantFactor = config.depthBiasConstant;
+		configInfo.rasterizationInfo.depthBiasSlopeFactor = config.depthBiasSlope;
+
+		configInfo.renderPass = renderPass;
+		configInfo.subpass = 0;
+	}
+
+} // namespace ve
@@ -1,7 +1,9 @@
 #include "ve/ve_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -11,13 +13,17 @@
 
 namespace ve {
 
-    VeSwapChain::VeSwapChain(VeDevice& deviceRef, VkExtent2D extent)
-        : device{ deviceRef }, windowExtent{ extent } {
+    VeSwapChain::VeSwapChain(VeDevice& deviceRef, VkExtent2D extent, const Config& config)
+        : device{ deviceRef }, windowExtent{ extent }, config{ config } {
         init();
     }
 
-    VeSwapChain::VeSwapChain(VeDevice& deviceRef, VkExtent2D extent, std::shared_ptr<VeSwapChain> previous)
-        : device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous } {
+    VeSwapChain::VeSwapChain(
+        VeDevice& deviceRef,
+        VkExtent2D extent,
+        std::shared_ptr<VeSwapChain> previous,
+        const Config& config)
+        : device{ deviceRef }, windowExtent{ extent }, config{ config }, oldSwapChain{ previous } {
         init();
 
 		// clean up old swap chain
@@ -25,11 +31,26 @@ namespace ve {
     }
 
 	void VeSwapChain::init() {
+        assert(
+            (config.msaaSamples == VK_SAMPLE_COUNT_1_BIT || !config.sampledDepth) &&
+            "Sampled depth is not supported with multisampling");
+        assert(
+            (!config.dynamicRendering || device.supportsDynamicRendering()) &&
+            "Dynamic rendering is not supported by the device");
+        msaaSamples = std::min(config.msaaSamples, device.getMaxUsableSampleCount());
+
         createSwapChain();
         createImageViews();
-        createRenderPass();
+        if (!config.dynamicRendering) {
+            renderPass = createRenderPass(RenderPassStage::Complete);
+            suspendingRenderPass = createRenderPass(RenderPassStage::Suspending);
+            resumingRenderPass = createRenderPass(RenderPassStage::Resuming);
+        }
+        createColorResources();
         createDepthResources();
-        createFramebuffers();
+        if (!config.dynamicRendering) {
+            createFramebuffers();
+        }
         createSyncObjects();
 	}
 
@@ -44,17 +65,23 @@ namespace ve {
             swapChain = nullptr;
         }
 
-        for (int i = 0; i < depthImages.size(); i++) {
-            vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-            vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+        if (colorImage != VK_NULL_HANDLE) {
+            vkDestroyImageView(device.device(), colorImageView, nullptr);
+            vkDestroyImage(device.device(), colorImage, nullptr);
+            vkFreeMemory(device.device(), colorImageMemory, nullptr);
         }
 
+        vkDestroyImageView(device.device(), depthImageView, nullptr);
+        vkDestroyImage(device.device(), depthImage, nullptr);
+        vkFreeMemory(device.device(), depthImageMemory, nullptr);
+
         for (auto framebuffer : swapChainFramebuffers) {
             vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
         }
 
         vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        vkDestroyRenderPass(device.device(), suspendingRenderPass, nullptr);
+        vkDestroyRenderPass(device.device(), resumingRenderPass, nullptr);
 
         // cleanup synchronization objects
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -214,16 +241,24 @@ namespace ve {
         }
     }
 
-    void VeSwapChain::createRenderPass() {
+    VkRenderPass VeSwapChain::createRenderPass(RenderPassStage stage) {
+        // all stages share attachments, subpasses and dependencies so they stay compatible with the same
+        // framebuffers and pipelines, only load/store ops and layouts at the split differ
+        bool suspending = stage == RenderPassStage::Suspending;
+        bool resuming = stage == RenderPassStage::Resuming;
+        // with MSAA attachment 0 is the multisampled color image and the swap chain image is resolved into
+        // attachment 2, both are shared by all frames like the depth image
+        bool multisampled = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
-        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.samples = msaaSamples;
+        depthAttachment.loadOp = resuming ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = suspending ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.initialLayout = resuming ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = suspending ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef{};
         depthAttachmentRef.attachment = 1;
@@ -231,51 +266,140 @@ namespace ve {
 
         VkAttachmentDescription colorAttachment = {};
         colorAttachment.format = getSwapChainImageFormat();
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.samples = msaaSamples;
+        colorAttachment.loadOp = resuming ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = multisampled && !suspending ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.initialLayout = resuming ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = suspending || multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
         colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+        // fully overwritten by the resolve at the end of the main subpass
+        VkAttachmentDescription resolveAttachment = {};
+        resolveAttachment.format = getSwapChainImageFormat();
+        resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        resolveAttachment.finalLayout = suspending ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkAttachmentReference resolveAttachmentRef = {};
+        resolveAttachmentRef.attachment = 2;
+        resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
         VkSubpassDescription subpass = {};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+        // the depth image is shared between frames, so its writes also wait for the previous frame's
+        VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        VkPipelineStageFlags previousDepthStages = depthStages;
+        if (config.sampledDepth) {
+            previousDepthStages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        }
+
+        // so is the multisampled color image
+        VkAccessFlags previousColorAccess = multisampled ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+
         VkSubpassDependency dependency = {};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.srcAccessMask = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | previousColorAccess;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | previousDepthStages;
         dependency.dstSubpass = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | depthStages;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-        std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+        std::vector<VkSubpassDescription> subpasses = { subpass };
+        std::vector<VkSubpassDependency> dependencies = { dependency };
+
+        if (config.depthPrePass) {
+            // depth-only subpass first, the main subpass then tests against its depth
+            VkSubpassDescription prePass = {};
+            prePass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            prePass.colorAttachmentCount = 0;
+            prePass.pDepthStencilAttachment = &depthAttachmentRef;
+            subpasses.insert(subpasses.begin(), prePass);
+
+            dependencies[0].dstSubpass = getMainSubpass();
+            dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            dependencies[0].srcAccessMask = previousColorAccess;
+            dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+            VkSubpassDependency prePassDependency = {};
+            prePassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+            prePassDependency.srcStageMask = previousDepthStages;
+            prePassDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            prePassDependency.dstSubpass = DEPTH_PREPASS_SUBPASS;
+            prePassDependency.dstStageMask = depthStages;
+            prePassDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            dependencies.push_back(prePassDependency);
+
+            VkSubpassDependency depthDependency = {};
+            depthDependency.srcSubpass = DEPTH_PREPASS_SUBPASS;
+            depthDependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            depthDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            depthDependency.dstSubpass = getMainSubpass();
+            depthDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            depthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            depthDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+            dependencies.push_back(depthDependency);
+        }
+
+        // dependencies are part of render pass compatibility, so every stage gets the ones the split needs:
+        // the external dependencies wait for the compute work between the passes and order the color
+        // writes after the suspending pass's, and the main subpass's writes are made visible to that work
+        for (auto& dependency : dependencies) {
+            if (dependency.srcSubpass == VK_SUBPASS_EXTERNAL) {
+                dependency.srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                dependency.srcAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            }
+        }
+        VkSubpassDependency suspendDependency = {};
+        suspendDependency.srcSubpass = getMainSubpass();
+        suspendDependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        suspendDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        suspendDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        suspendDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        suspendDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies.push_back(suspendDependency);
+
+        std::vector<VkAttachmentDescription> attachments = { colorAttachment, depthAttachment };
+        if (multisampled) {
+            attachments.push_back(resolveAttachment);
+        }
         VkRenderPassCreateInfo renderPassInfo = {};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         renderPassInfo.pAttachments = attachments.data();
-        renderPassInfo.subpassCount = 1;
-        renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
 
-        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        VkRenderPass createdRenderPass;
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &createdRenderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
+        return createdRenderPass;
     }
 
     void VeSwapChain::createFramebuffers() {
         swapChainFramebuffers.resize(imageCount());
         for (size_t i = 0; i < imageCount(); i++) {
-            std::array<VkImageView, 2> attachments = { swapChainImageViews[i], depthImageViews[i] };
+            std::vector<VkImageView> attachments = { swapChainImageViews[i], depthImageView };
+            if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+                attachments = { colorImageView, depthImageView, swapChainImageViews[i] };
+            }
 
             VkExtent2D swapChainExtent = getSwapChainExtent();
             VkFramebufferCreateInfo framebufferInfo = {};
@@ -297,52 +421,99 @@ namespace ve {
         }
     }
 
+    void VeSwapChain::createColorResources() {
+        if (msaaSamples == VK_SAMPLE_COUNT_1_BIT) {
+            return;
+        }
+
+        VkExtent2D swapChainExtent = getSwapChainExtent();
+
+        // only ever resolved, never stored, so like depth it can stay in lazily allocated tile memory
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = swapChainImageFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        imageInfo.samples = msaaSamples;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.flags = 0;
+
+        device.createTransientAttachment(imageInfo, colorImage, colorImageMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = colorImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = swapChainImageFormat;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &colorImageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+    }
+
     void VeSwapChain::createDepthResources() {
         VkFormat depthFormat = findDepthFormat();
 		swapChainDepthFormat = depthFormat;
         VkExtent2D swapChainExtent = getSwapChainExtent();
 
-        depthImages.resize(imageCount());
-        depthImageMemorys.resize(imageCount());
-        depthImageViews.resize(imageCount());
-
-        for (int i = 0; i < depthImages.size(); i++) {
-            VkImageCreateInfo imageInfo{};
-            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-            imageInfo.imageType = VK_IMAGE_TYPE_2D;
-            imageInfo.extent.width = swapChainExtent.width;
-            imageInfo.extent.height = swapChainExtent.height;
-            imageInfo.extent.depth = 1;
-            imageInfo.mipLevels = 1;
-            imageInfo.arrayLayers = 1;
-            imageInfo.format = depthFormat;
-            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // frames are recorded on one queue and the render pass dependencies order each frame's depth
+        // writes after the previous frame's, so a single depth image serves every frame in flight
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = depthFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.samples = msaaSamples;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.flags = 0;
+
+        if (config.sampledDepth) {
+            // sampled so compute passes between a suspended and resumed render pass can read it
+            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+        }
+        else if (config.dynamicRendering && config.depthPrePass) {
+            // the pre-pass and main pass are separate rendering scopes, so depth is stored in between
             imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-            imageInfo.flags = 0;
-
-            device.createImageWithInfo(
-                imageInfo,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                depthImages[i],
-                depthImageMemorys[i]);
-
-            VkImageViewCreateInfo viewInfo{};
-            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            viewInfo.image = depthImages[i];
-            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            viewInfo.format = depthFormat;
-            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-            viewInfo.subresourceRange.baseMipLevel = 0;
-            viewInfo.subresourceRange.levelCount = 1;
-            viewInfo.subresourceRange.baseArrayLayer = 0;
-            viewInfo.subresourceRange.layerCount = 1;
+            device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+        }
+        else {
+            // cleared on load and never stored, so it can live in lazily allocated tile memory
+            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            device.createTransientAttachment(imageInfo, depthImage, depthImageMemory);
+        }
 
-            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create texture image view!");
-            }
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = depthImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = depthFormat;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
         }
     }
 
@@ -0,0 +1,60 @@
+// Clustered forward lighting, matches VeClusteredLighting.
+// Define CLUSTER_SET before including to choose the descriptor set (default 1).
+//
+//   #include "clustered_lighting.glsl"
+//   ...
+//   uint cluster = clusterIndex(gl_FragCoord.xy, viewDepth);
+//   uvec2 range = clusterLightRange(cluster);
+//   for (uint i = 0; i < range.y; i++) {
+//     PointLight light = lights[lightIndices[range.x + i]];
+//     ...
+//   }
+
+#ifndef CLUSTERED_LIGHTING_GLSL
+#define CLUSTERED_LIGHTING_GLSL
+
+#ifndef CLUSTER_SET
+#define CLUSTER_SET 1
+#endif
+
+struct PointLight {
+  vec4 position; // w is range
+  vec4 color;    // w is intensity
+};
+
+layout(std430, set = CLUSTER_SET, binding = 0) readonly buffer PointLights {
+  uvec4 lightCount;
+  PointLight lights[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 1) readonly buffer ClusterGrid {
+  uvec4 gridSize;     // tiles x, tiles y, depth slices, light count
+  vec4 screenParams;  // viewport width, height, slice scale, slice bias
+  uvec2 clusters[];   // offset into lightIndices, light count
+};
+
+layout(std430, set = CLUSTER_SET, binding = 2) readonly buffer ClusterLightIndices {
+  uint lightIndices[];
+};
+
+// viewDepth is the positive view space z of the fragment
+uint clusterIndex(vec2 fragCoord, float viewDepth) {
+  uvec2 tile = uvec2(fragCoord / screenParams.xy * vec2(gridSize.xy));
+  tile = min(tile, gridSize.xy - 1u);
+  float slice = log(viewDepth) * screenParams.z + screenParams.w;
+  uint z = uint(clamp(slice, 0.0, float(gridSize.z - 1u)));
+  return (z * gridSize.y + tile.y) * gridSize.x + tile.x;
+}
+
+uvec2 clusterLightRange(uint cluster) {
+  return clusters[cluster];
+}
+
+// inverse square falloff windowed to reach zero at the light's range, so culled lights leave no seam
+float clusterLightAttenuation(PointLight light, vec3 toLight) {
+  float distanceSquared = dot(toLight, toLight);
+  float window = clamp(1.0 - distanceSquared / (light.position.w * light.position.w), 0.0, 1.0);
+  return window * window / distanceSquared;
+}
+
+#endif
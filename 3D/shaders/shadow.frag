@@ -0,0 +1,5 @@
+#version 450
+
+// depth is written by fixed function, no color attachments
+void main() {
+}
@@ -0,0 +1,58 @@
+// Cascaded shadow lookup, matches VeShadowMaps and CascadeShadowData.
+// Define SHADOW_SET / SHADOW_BINDING before including to choose where the data lives (default set 2).
+//
+//   float visibility = cascadedShadow(fragWorldPos, viewDepth);
+
+#ifndef SHADOW_GLSL
+#define SHADOW_GLSL
+
+#ifndef SHADOW_SET
+#define SHADOW_SET 2
+#endif
+
+#ifndef SHADOW_BINDING
+#define SHADOW_BINDING 0
+#endif
+
+#define MAX_SHADOW_CASCADES 4
+
+layout(std140, set = SHADOW_SET, binding = SHADOW_BINDING) uniform CascadeShadowData {
+  mat4 worldToShadow[MAX_SHADOW_CASCADES]; // world space to atlas uv and depth
+  vec4 splitDepths;                        // view space far distance of each cascade
+  vec4 params;                             // cascade count, 1 / atlas size
+  vec4 tileBounds[MAX_SHADOW_CASCADES];    // atlas uv min (xy) and max (zw) for the filter taps
+} shadowData;
+
+layout(set = SHADOW_SET, binding = SHADOW_BINDING + 1) uniform sampler2DShadow shadowAtlas;
+
+uint shadowCascade(float viewDepth) {
+  uint count = uint(shadowData.params.x);
+  for (uint i = 0; i < count; i++) {
+    if (viewDepth <= shadowData.splitDepths[i]) {
+      return i;
+    }
+  }
+  return count;
+}
+
+// 1 is fully lit; the comparison sampler filters 2x2 texels, the 4 offsets widen that to 3x3
+float cascadedShadow(vec3 worldPosition, float viewDepth) {
+  uint cascade = shadowCascade(viewDepth);
+  if (cascade >= uint(shadowData.params.x)) {
+    return 1.0;
+  }
+
+  vec4 shadowCoord = shadowData.worldToShadow[cascade] * vec4(worldPosition, 1.0);
+  // keeps the taps inside the cascade's atlas tile
+  vec4 bounds = shadowData.tileBounds[cascade];
+  shadowCoord.xy = clamp(shadowCoord.xy, bounds.xy, bounds.zw);
+  float texel = shadowData.params.y;
+  float visibility = 0.0;
+  visibility += texture(shadowAtlas, vec3(shadowCoord.xy + vec2(-0.5, -0.5) * texel, shadowCoord.z));
+  visibility += texture(shadowAtlas, vec3(shadowCoord.xy + vec2(0.5, -0.5) * texel, shadowCoord.z));
+  visibility += texture(shadowAtlas, vec3(shadowCoord.xy + vec2(-0.5, 0.5) * texel, shadowCoord.z));
+  visibility += texture(shadowAtlas, vec3(shadowCoord.xy + vec2(0.5, 0.5) * texel, shadowCoord.z));
+  return visibility * 0.25;
+}
+
+#endif
@@ -0,0 +1,12 @@
+#version 450
+
+// depth-only caster pass for VeShadowMaps
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push {
+  mat4 lightModelViewProjection; // cascade view projection * model
+} push;
+
+void main() {
+  gl_Position = push.lightModelViewProjection * vec4(position, 1.0);
+}
@@ -0,0 +1,397 @@
+#!/usr/bin/env python3
+"""Offline shader build step.
+
+Compiles every GLSL stage in a shader directory to SPIR-V next to its source
+("shader.vert" -> "shader.vert.spv"), the same layout tools/compile.bat in the
+2D project produces. Each stage is only recompiled when the source or one of the
+files it #includes changed, tracked through the depfiles glslc writes with -MD.
+
+Alongside every .spv a .spv.json file is written with reflection metadata
+(vertex inputs, descriptor bindings, push constant block) so shader interface
+changes show up in review.
+
+Runs anywhere glslc does. glslc is looked up through $GLSLC, $VULKAN_SDK and
+PATH, in that order.
+
+    python3 tools/compile_shaders.py [shader_dir] [--force] [--validate]
+"""
+
+import argparse
+import concurrent.futures
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+STAGE_EXTENSIONS = (".vert", ".frag", ".comp", ".geom", ".tesc", ".tese")
+DEFAULT_SHADER_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "shaders")
+
+
+# ******************************	Tool lookup		*************************************** #
+def find_tool(name):
+    env_override = os.environ.get(name.upper().replace("-", "_"))
+    if env_override:
+        return env_override
+
+    executable = name + (".exe" if os.name == "nt" else "")
+    sdk = os.environ.get("VULKAN_SDK")
+    if sdk:
+        for bin_dir in ("bin", "Bin"):
+            candidate = os.path.join(sdk, bin_dir, executable)
+            if os.path.isfile(candidate):
+                return candidate
+
+    return shutil.which(name)
+
+
+# ******************************	Dependencies		*************************************** #
+def read_depfile(path):
+    """Returns the prerequisites listed in a make style depfile, or None if it is missing."""
+    try:
+        with open(path, "r", encoding="utf-8") as f:
+            content = f.read()
+    except OSError:
+        return None
+
+    content = content.replace("\\\r\n", " ").replace("\\\n", " ")
+    _, _, prerequisites = content.partition(": ")
+
+    # a backslash only escapes a space, '#' or another backslash, elsewhere it is a Windows path separator
+    deps = []
+    current = ""
+    i = 0
+    while i < len(prerequisites):
+        ch = prerequisites[i]
+        i += 1
+        if ch == "\\" and i < len(prerequisites) and prerequisites[i] in " #\\":
+            current += prerequisites[i]
+            i += 1
+        elif ch.isspace():
+            if current:
+                deps.append(current)
+            current = ""
+        else:
+            current += ch
+    if current:
+        deps.append(current)
+    return deps
+
+
+def is_up_to_date(source, output, depfile, metadata):
+    if not all(os.path.exists(path) for path in (output, depfile, metadata)):
+        return False
+
+    deps = read_depfile(depfile)
+    if deps is None:
+        return False
+
+    output_time = os.path.getmtime(output)
+    for dep in [source] + deps:
+        if not os.path.exists(dep) or os.path.getmtime(dep) > output_time:
+            return False
+    return True
+
+
+# ******************************	SPIR-V reflection	*************************************** #
+SPIRV_MAGIC = 0x07230203
+
+OP_NAME = 5
+OP_MEMBER_NAME = 6
+OP_ENTRY_POINT = 15
+OP_TYPE_INT = 21
+OP_TYPE_FLOAT = 22
+OP_TYPE_VECTOR = 23
+OP_TYPE_MATRIX = 24
+OP_TYPE_IMAGE = 25
+OP_TYPE_SAMPLER = 26
+OP_TYPE_SAMPLED_IMAGE = 27
+OP_TYPE_ARRAY = 28
+OP_TYPE_RUNTIME_ARRAY = 29
+OP_TYPE_STRUCT = 30
+OP_TYPE_POINTER = 32
+OP_CONSTANT = 43
+OP_VARIABLE = 59
+OP_DECORATE = 71
+OP_MEMBER_DECORATE = 72
+
+DECORATION_BLOCK = 2
+DECORATION_BUFFER_BLOCK = 3
+DECORATION_ARRAY_STRIDE = 6
+DECORATION_MATRIX_STRIDE = 7
+DECORATION_BUILTIN = 11
+DECORATION_LOCATION = 30
+DECORATION_BINDING = 33
+DECORATION_DESCRIPTOR_SET = 34
+DECORATION_OFFSET = 35
+
+STORAGE_UNIFORM_CONSTANT = 0
+STORAGE_INPUT = 1
+STORAGE_UNIFORM = 2
+STORAGE_OUTPUT = 3
+STORAGE_PUSH_CONSTANT = 9
+STORAGE_STORAGE_BUFFER = 12
+
+EXECUTION_MODELS = {0: "vertex", 1: "tessellation_control", 2: "tessellation_evaluation",
+                    3: "geometry", 4: "fragment", 5: "compute"}
+
+IMAGE_DIM_BUFFER = 5
+IMAGE_DIM_SUBPASS_DATA = 6
+
+
+def decode_string(words):
+    raw = struct.pack("<%dI" % len(words), *words)
+    return raw.split(b"\0", 1)[0].decode("utf-8")
+
+
+class SpirvModule:
+    def __init__(self, code):
+        if len(code) < 20 or len(code) % 4 != 0:
+            raise ValueError("not a SPIR-V module")
+        words = struct.unpack("<%dI" % (len(code) // 4), code)
+        if words[0] != SPIRV_MAGIC:
+            raise ValueError("bad SPIR-V magic number")
+
+        self.names = {}
+        self.member_names = {}
+        self.decorations = {}
+        self.member_decorations = {}
+        self.types = {}
+        self.constants = {}
+        self.variables = []
+        self.entry_point = None
+
+        i = 5
+        while i < len(words):
+            word_count = words[i] >> 16
+            opcode = words[i] & 0xFFFF
+            if word_count == 0:
+                raise ValueError("malformed SPIR-V instruction")
+            self._parse(opcode, words[i + 1:i + word_count])
+            i += word_count
+
+    def _parse(self, op, args):
+        if op == OP_NAME:
+            self.names[args[0]] = decode_string(args[1:])
+        elif op == OP_MEMBER_NAME:
+            self.member_names[(args[0], args[1])] = decode_string(args[2:])
+        elif op == OP_ENTRY_POINT and self.entry_point is None:
+            self.entry_point = (EXECUTION_MODELS.get(args[0], "unknown"), decode_string(args[2:]))
+        elif op == OP_DECORATE:
+            self.decorations.setdefault(args[0], {})[args[1]] = args[2] if len(args) > 2 else True
+        elif op == OP_MEMBER_DECORATE:
+            self.member_decorations.setdefault((args[0], args[1]), {})[args[2]] = args[3] if len(args) > 3 else True
+        elif op == OP_CONSTANT:
+            self.constants[args[1]] = args[2]
+        elif op == OP_VARIABLE:
+            self.variables.append((args[1], args[0], args[2]))
+        elif op in (OP_TYPE_INT, OP_TYPE_FLOAT, OP_TYPE_VECTOR, OP_TYPE_MATRIX, OP_TYPE_IMAGE, OP_TYPE_SAMPLER,
+                    OP_TYPE_SAMPLED_IMAGE, OP_TYPE_ARRAY, OP_TYPE_RUNTIME_ARRAY, OP_TYPE_STRUCT, OP_TYPE_POINTER):
+            self.types[args[0]] = (op, args[1:])
+
+    def type_size(self, type_id):
+        op, args = self.types[type_id]
+        if op in (OP_TYPE_INT, OP_TYPE_FLOAT):
+            return args[0] // 8
+        if op == OP_TYPE_VECTOR:
+            return self.type_size(args[0]) * args[1]
+        if op == OP_TYPE_MATRIX:
+            return self.type_size(args[0]) * args[1]
+        if op == OP_TYPE_ARRAY:
+            stride = self.decorations.get(type_id, {}).get(DECORATION_ARRAY_STRIDE, self.type_size(args[0]))
+            return stride * self.constants.get(args[1], 1)
+        if op == OP_TYPE_STRUCT:
+            size = 0
+            for member, member_type in enumerate(args):
+                decorations = self.member_decorations.get((type_id, member), {})
+                member_size = self.type_size(member_type)
+                if DECORATION_MATRIX_STRIDE in decorations and self.types[member_type][0] == OP_TYPE_MATRIX:
+                    member_size = decorations[DECORATION_MATRIX_STRIDE] * self.types[member_type][1][1]
+                size = max(size, decorations.get(DECORATION_OFFSET, 0) + member_size)
+            return size
+        return 0
+
+    def vertex_format(self, type_id):
+        op, args = self.types[type_id]
+        count = 1
+        if op == OP_TYPE_VECTOR:
+            op, scalar_args = self.types[args[0]]
+            count = args[1]
+        else:
+            scalar_args = args
+
+        width = scalar_args[0]
+        if op == OP_TYPE_FLOAT:
+            suffix = "SFLOAT"
+        elif scalar_args[1]:
+            suffix = "SINT"
+        else:
+            suffix = "UINT"
+        channels = "".join("%s%d" % (c, width) for c in "RGBA"[:count])
+        return "VK_FORMAT_%s_%s" % (channels, suffix)
+
+    def descriptor_type(self, type_id, storage_class):
+        count = 1
+        op, args = self.types[type_id]
+        if op == OP_TYPE_ARRAY:
+            count = self.constants.get(args[1], 1)
+            type_id = args[0]
+        elif op == OP_TYPE_RUNTIME_ARRAY:
+            count = 0
+            type_id = args[0]
+
+        op, args = self.types[type_id]
+        decorations = self.decorations.get(type_id, {})
+        if storage_class == STORAGE_STORAGE_BUFFER or DECORATION_BUFFER_BLOCK in decorations:
+            return "storage_buffer", count
+        if storage_class == STORAGE_UNIFORM:
+            return "uniform_buffer", count
+        if op == OP_TYPE_SAMPLER:
+            return "sampler", count
+        if op == OP_TYPE_SAMPLED_IMAGE:
+            return "combined_image_sampler", count
+        if op == OP_TYPE_IMAGE:
+            dim, sampled = args[1], args[5]
+            if dim == IMAGE_DIM_SUBPASS_DATA:
+                return "input_attachment", count
+            if dim == IMAGE_DIM_BUFFER:
+                return ("uniform_texel_buffer" if sampled == 1 else "storage_texel_buffer"), count
+            return ("sampled_image" if sampled == 1 else "storage_image"), count
+        return "unknown", count
+
+    def reflect(self):
+        stage, entry = self.entry_point or ("unknown", "main")
+        result = {"stage": stage, "entryPoint": entry, "inputs": [], "outputs": [],
+                  "descriptorSets": [], "pushConstants": None}
+
+        for var_id, pointer_id, storage_class in self.variables:
+            pointee = self.types[pointer_id][1][1]
+            decorations = self.decorations.get(var_id, {})
+            name = self.names.get(var_id, "") or self.names.get(pointee, "")
+
+            if storage_class in (STORAGE_INPUT, STORAGE_OUTPUT):
+                if DECORATION_BUILTIN in decorations or DECORATION_LOCATION not in decorations:
+                    continue
+                if self.types[pointee][0] not in (OP_TYPE_INT, OP_TYPE_FLOAT, OP_TYPE_VECTOR):
+                    continue
+                entry = {"location": decorations[DECORATION_LOCATION], "name": name,
+                         "format": self.vertex_format(pointee)}
+                result["inputs" if storage_class == STORAGE_INPUT else "outputs"].append(entry)
+            elif storage_class == STORAGE_PUSH_CONSTANT:
+                result["pushConstants"] = {"name": name, "size": self.type_size(pointee)}
+            elif storage_class in (STORAGE_UNIFORM_CONSTANT, STORAGE_UNIFORM, STORAGE_STORAGE_BUFFER):
+                if DECORATION_BINDING not in decorations:
+                    continue
+                descriptor_type, count = self.descriptor_type(pointee, storage_class)
+                result["descriptorSets"].append({
+                    "set": decorations.get(DECORATION_DESCRIPTOR_SET, 0),
+                    "binding": decorations[DECORATION_BINDING],
+                    "type": descriptor_type,
+                    "count": count,
+                    "name": name,
+                })
+
+        result["inputs"].sort(key=lambda e: e["location"])
+        result["outputs"].sort(key=lambda e: e["location"])
+        result["descriptorSets"].sort(key=lambda e: (e["set"], e["binding"]))
+        return result
+
+
+def write_reflection(spv_path, json_path):
+    with open(spv_path, "rb") as f:
+        module = SpirvModule(f.read())
+    with open(json_path, "w", encoding="utf-8", newline="\n") as f:
+        json.dump(module.reflect(), f, indent=2)
+        f.write("\n")
+
+
+# ******************************	Compilation		*************************************** #
+def compile_shader(glslc, spirv_val, source, include_dirs, force):
+    output = source + ".spv"
+    depfile = output + ".d"
+    metadata = output + ".json"
+
+    if not force and is_up_to_date(source, output, depfile, metadata):
+        return source, None, False
+
+    # compile to a temporary file so a failed build never leaves a truncated .spv behind
+    temp_output = output + ".tmp"
+    command = [glslc, source, "-o", temp_output, "-MD", "-MF", depfile, "-MT", output]
+    for include_dir in include_dirs:
+        command += ["-I", include_dir]
+
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0:
+        if os.path.exists(temp_output):
+            os.remove(temp_output)
+        return source, result.stderr or result.stdout, False
+
+    if spirv_val:
+        validation = subprocess.run([spirv_val, temp_output], capture_output=True, text=True)
+        if validation.returncode != 0:
+            os.remove(temp_output)
+            return source, validation.stderr or validation.stdout, False
+
+    os.replace(temp_output, output)
+    try:
+        write_reflection(output, metadata)
+    except (ValueError, KeyError, IndexError) as e:
+        return source, "failed to reflect %s: %s" % (output, e), True
+    return source, None, True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile GLSL shaders to SPIR-V with dependency tracking.")
+    parser.add_argument("shader_dir", nargs="?", default=DEFAULT_SHADER_DIR)
+    parser.add_argument("-I", dest="include_dirs", action="append", default=[], help="additional include directory")
+    parser.add_argument("--force", action="store_true", help="recompile every shader")
+    parser.add_argument("--validate", action="store_true", help="run spirv-val on every compiled module")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1)
+    args = parser.parse_args()
+
+    shader_dir = os.path.normpath(args.shader_dir)
+    if not os.path.isdir(shader_dir):
+        print("no shader directory at %s, nothing to compile" % shader_dir)
+        return 0
+
+    glslc = find_tool("glslc")
+    if glslc is None:
+        print("error: glslc not found, install the Vulkan SDK or set GLSLC", file=sys.stderr)
+        return 1
+
+    spirv_val = None
+    if args.validate:
+        spirv_val = find_tool("spirv-val")
+        if spirv_val is None:
+            print("error: --validate requires spirv-val", file=sys.stderr)
+            return 1
+
+    sources = sorted(
+        os.path.join(shader_dir, name) for name in os.listdir(shader_dir)
+        if os.path.splitext(name)[1] in STAGE_EXTENSIONS)
+    include_dirs = [shader_dir] + args.include_dirs
+
+    failed = 0
+    compiled = 0
+    up_to_date = 0
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        jobs = [pool.submit(compile_shader, glslc, spirv_val, source, include_dirs, args.force) for source in sources]
+        for job in jobs:
+            source, error, did_compile = job.result()
+            if did_compile:
+                compiled += 1
+                print("compiled %s" % source)
+            if error:
+                failed += 1
+                print("error: %s\n%s" % (source, error.rstrip()), file=sys.stderr)
+            if not did_compile and not error:
+                up_to_date += 1
+
+    print("%d shader(s), %d compiled, %d up to date, %d failed"
+          % (len(sources), compiled, up_to_date, failed))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())